@@ -11,6 +11,8 @@ import glob
 import json
 import multiprocessing
 import logging
+import os
+import subprocess
 
 import tqdm
 
@@ -43,6 +45,12 @@ def solve_maxis_timeout(file_name):
         return None
 
 
+def run_algorithms(file_name):
+    return dict(
+        dsatur=solve_dsatur_timeout(file_name),
+        maxis=solve_maxis_timeout(file_name))
+
+
 def evaluate(file_name):
     ''' For a given instance file, calculate features and run heuristics.
     In case of an error in any evaluation, the error message is logged
@@ -50,19 +58,51 @@ def evaluate(file_name):
     return dict(
         file_name=file_name,
         features=calculate_features(file_name),
-        algorithms=dict(
-            dsatur=solve_dsatur_timeout(file_name),
-            maxis=solve_maxis_timeout(file_name)),
+        algorithms=run_algorithms(file_name),
         )
 
 
-# Use multiprocessing to evaluate the complete instance set, write results to JSON file.
+def find_duplicates(directory, file_names):
+    ''' Map each instance file that is identical to an earlier one (the
+    same edges on the same vertex numbering) to the first file of its group,
+    using bin/dedup --identical from the C++ feature code on the directory
+    (file names could exceed the argument length limit). Returns an empty
+    mapping if that is not built. '''
+    executable = os.path.join(os.path.dirname(__file__), 'graph-features-cpp', 'bin', 'dedup')
+    try:
+        output = subprocess.check_output([executable, '--identical', directory], universal_newlines=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        logging.warning(f"Duplicate detection failed ({e}), evaluating all instances.")
+        return dict()
+    wanted = set(file_names)
+    duplicate_of = dict()
+    for group in output.split('=====')[2::2]:
+        members = [f for f in group.split() if f in wanted]
+        duplicate_of.update((other, members[0]) for other in members[1:])
+    return duplicate_of
+
 
-file_names = sorted(glob.glob('graphs/instances/g*.col'))
+# Use multiprocessing to evaluate the complete instance set, write results to JSON file.
+# Features of identical instances are not calculated again: they are taken
+# from the first instance in their group, with a 'duplicate_of' field. The
+# heuristics still run on every instance, as their results depend on more
+# than the edge set (file order, timing).
+
+instance_directory = 'graphs/instances'
+file_names = sorted(glob.glob(os.path.join(instance_directory, 'g*.col')))
+duplicate_of = find_duplicates(instance_directory, file_names)
 pool = multiprocessing.Pool()
 results = list(tqdm.tqdm(
-    pool.imap_unordered(evaluate, file_names),
-    total=len(file_names)))
+    pool.imap_unordered(evaluate, [f for f in file_names if f not in duplicate_of]),
+    total=len(file_names) - len(duplicate_of)))
+by_file = {result['file_name']: result for result in results}
+duplicates = sorted(duplicate_of.items())
+algorithms = list(tqdm.tqdm(
+    pool.imap(run_algorithms, [file_name for file_name, _ in duplicates]),
+    total=len(duplicates)))
+results.extend(
+    dict(file_name=file_name, features=by_file[first]['features'], algorithms=result, duplicate_of=first)
+    for (file_name, first), result in zip(duplicates, algorithms))
 
 with open('evolved-instances-results-tmp.json', 'w') as outfile:
     json.dump(results, outfile)
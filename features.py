@@ -76,6 +76,45 @@ def graph_features(n_vertices, edges):
     }
 
 
+def read_vertex_features(file_name):
+    ''' Map each instance ID in a per-vertex feature file written by
+    graph-features-cpp (bin/evaluate --vertex-features) to a dictionary of
+    column name: array of per-vertex values. Arrays are read-only views into
+    a memory map of the file (see graph-features-cpp/columnar.hpp). '''
+    data = np.memmap(file_name, dtype=np.uint8, mode='r')
+    if bytes(data[:8]) != b'GFVCOL02':
+        raise ValueError(f"{file_name} is not a per-vertex feature file.")
+
+    def u64(offset):
+        if offset + 8 > len(data):
+            raise ValueError(f"{file_name} is truncated.")
+        return int(data[offset:offset + 8].view('<u8')[0])
+
+    n_columns = u64(8)
+    offset = 16 + 32 * n_columns
+    if offset > len(data):
+        raise ValueError(f"{file_name} is truncated.")
+    names = [
+        bytes(data[16 + 32 * k:48 + 32 * k]).rstrip(b'\0').decode()
+        for k in range(n_columns)]
+    result = dict()
+    while offset < len(data):
+        id_length = u64(offset)
+        id_padded = (id_length + 7) // 8 * 8
+        n_vertices = u64(offset + 8 + id_padded)
+        values_start = offset + 16 + id_padded
+        values_end = values_start + 8 * n_columns * n_vertices
+        if values_end > len(data):
+            raise ValueError(f"{file_name} is truncated.")
+        instance_id = bytes(data[offset + 8:offset + 8 + id_length]).decode()
+        values = data[values_start:values_end].view('<f8')
+        result[instance_id] = {
+            name: values[k * n_vertices:(k + 1) * n_vertices]
+            for k, name in enumerate(names)}
+        offset = values_end
+    return result
+
+
 if __name__ == '__main__':
     # Run a simple test when this file is run as a script.
     from pprint import pprint
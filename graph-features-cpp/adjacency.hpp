@@ -0,0 +1,74 @@
+
+#ifndef ADJACENCY_HPP
+#define ADJACENCY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "gsl/span"
+
+
+namespace graph {
+
+    // Compressed sparse row adjacency structure for native traversal kernels.
+    // Each undirected edge is stored in both directions, self loops are dropped
+    // (they never affect distances). Vertex ids are 32 bit and each neighbour
+    // list is sorted, so adjacency tests can binary search.
+
+    class Adjacency {
+
+        std::vector<std::size_t> offsets;
+        std::vector<uint32_t> targets;
+
+     public:
+
+        Adjacency() : offsets(1, 0) {}
+
+        // Build from an undirected edge list over vertices 0 .. n-1.
+        Adjacency(int n, const std::vector<std::pair<int, int>>& edges) : offsets(n + 1, 0) {
+            for (const auto& [a, b] : edges) {
+                if (a == b) { continue; }
+                offsets[a + 1]++;
+                offsets[b + 1]++;
+            }
+            for (int v = 0; v < n; v++) {
+                offsets[v + 1] += offsets[v];
+            }
+            targets.resize(offsets[n]);
+            std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+            for (const auto& [a, b] : edges) {
+                if (a == b) { continue; }
+                targets[fill[a]++] = b;
+                targets[fill[b]++] = a;
+            }
+            for (int v = 0; v < n; v++) {
+                std::sort(targets.begin() + offsets[v], targets.begin() + offsets[v + 1]);
+            }
+        }
+
+        // From CSR arrays: n + 1 offsets from 0, and each vertex's sorted
+        // neighbours (both directions of every edge, no self loops).
+        Adjacency(std::vector<std::size_t> offsets, std::vector<uint32_t> targets)
+            : offsets(std::move(offsets)), targets(std::move(targets)) {}
+
+        int vertices() const { return offsets.size() - 1; }
+        std::size_t entries() const { return targets.size(); }
+        int degree(int v) const { return offsets[v + 1] - offsets[v]; }
+
+        gsl::span<const uint32_t> neighbours(int v) const {
+            return gsl::span<const uint32_t>{targets.data() + offsets[v], degree(v)};
+        }
+
+        bool adjacent(int u, int v) const {
+            if (degree(u) > degree(v)) { std::swap(u, v); }
+            return std::binary_search(targets.begin() + offsets[u], targets.begin() + offsets[u + 1], (uint32_t) v);
+        }
+
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+#include "gsl/gsl_assert"
+#include "builder.hpp"
+#include "parallel.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    const int radix_bits = 11;
+
+    // Bits needed for vertex ids below n.
+    int id_bits(int n) {
+        int bits = 0;
+        while (bits < 31 && (1 << bits) < n) { bits++; }
+        return bits;
+    }
+
+    // Edges per thread below which a radix pass is not split.
+    const int min_chunk = 1 << 16;
+
+    // Stable counting sort pass on one digit of the first or second id. Each
+    // thread counts digits in its chunk of edges, then writes them after
+    // those with the same digit in earlier chunks.
+    void radix_pass(const vector<pair<int, int>>& from, vector<pair<int, int>>& to, bool first, int shift,
+                    int threads) {
+        const int mask = (1 << radix_bits) - 1;
+        const int m = from.size();
+        auto digit = [&](const pair<int, int>& e) { return ((first ? e.first : e.second) >> shift) & mask; };
+        threads = max(1, min(threads, m / min_chunk));
+
+        vector<vector<std::size_t>> next(threads, vector<std::size_t>(1 << radix_bits, 0));
+        parallel_ranges(m, threads, [&](int t, int begin, int end) {
+            for (int i = begin; i < end; i++) { next[t][digit(from[i])]++; }
+        });
+        std::size_t start = 0;
+        for (int d = 0; d < (1 << radix_bits); d++) {
+            for (int t = 0; t < threads; t++) {
+                const std::size_t count = next[t][d];
+                next[t][d] = start;
+                start += count;
+            }
+        }
+        parallel_ranges(m, threads, [&](int t, int begin, int end) {
+            for (int i = begin; i < end; i++) { to[next[t][digit(from[i])]++] = from[i]; }
+        });
+    }
+
+}
+
+
+void GraphBuilder::add_edges(gsl::span<const pair<int, int>> added) {
+    for (const auto& [a, b] : added) { check(a, b); }
+    edges.insert(edges.end(), added.begin(), added.end());
+    sorted = sorted && added.empty();
+}
+
+
+void GraphBuilder::add_edges(vector<pair<int, int>>&& added) {
+    if (!edges.empty()) {
+        add_edges(gsl::span<const pair<int, int>>{added.data(), (std::ptrdiff_t) added.size()});
+        return;
+    }
+    for (const auto& [a, b] : added) { check(a, b); }
+    edges = move(added);
+    sorted = edges.empty();
+}
+
+
+void GraphBuilder::sort() {
+    if (sorted) { return; }
+    for (auto& [a, b] : edges) {
+        if (a > b) { swap(a, b); }
+    }
+
+    // LSD radix sort by (first, second): digits of second, then of first,
+    // alternating between the edges and one scratch buffer.
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    const int bits = id_bits(n);
+    vector<pair<int, int>> scratch(edges.size());
+    for (const bool first : {false, true}) {
+        for (int shift = 0; shift < bits; shift += radix_bits) {
+            radix_pass(edges, scratch, first, shift, threads);
+            swap(edges, scratch);
+        }
+    }
+    sorted = true;
+}
+
+
+std::size_t GraphBuilder::deduplicate() {
+    sort();
+    const std::size_t before = edges.size();
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+    return before - edges.size();
+}
+
+
+std::size_t GraphBuilder::drop_self_loops() {
+    const std::size_t before = edges.size();
+    edges.erase(remove_if(edges.begin(), edges.end(), [](const pair<int, int>& e) { return e.first == e.second; }),
+                edges.end());
+    return before - edges.size();
+}
+
+
+UndirectedGraph GraphBuilder::build() {
+    sort();
+
+    // Degrees, split into neighbours below and above each vertex.
+    vector<std::size_t> offsets(n + 1, 0), lower(n, 0);
+    vector<uint32_t> self_loops;
+    for (const auto& [a, b] : edges) {
+        if (a == b) {
+            self_loops.push_back(a);
+            continue;
+        }
+        offsets[a + 1]++;
+        offsets[b + 1]++;
+        lower[b]++;
+    }
+    for (int v = 0; v < n; v++) { offsets[v + 1] += offsets[v]; }
+
+    // In (a, b) order each vertex meets its lower neighbours in increasing
+    // order, then its upper ones, so filling the two parts of each list in
+    // edge order leaves it sorted.
+    vector<uint32_t> targets(offsets[n]);
+    vector<std::size_t> below(offsets.begin(), offsets.end() - 1), above(n);
+    for (int v = 0; v < n; v++) { above[v] = offsets[v] + lower[v]; }
+    for (const auto& [a, b] : edges) {
+        if (a == b) { continue; }
+        targets[below[b]++] = a;
+        targets[above[a]++] = b;
+    }
+    Ensures(n == 0 || above[n - 1] == offsets[n]);
+
+    edges = vector<pair<int, int>>();
+    sorted = true;
+    return UndirectedGraph(Adjacency(move(offsets), move(targets)), move(self_loops));
+}
+
+
+}
@@ -0,0 +1,73 @@
+#ifndef BUILDER_HPP
+#define BUILDER_HPP
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "gsl/span"
+
+#include "graph.hpp"
+
+
+namespace graph {
+
+    // Bulk construction of an UndirectedGraph over vertices 0 .. n-1. Edges
+    // are collected as int pairs (a vector passed by move into an empty
+    // builder is adopted without copying), then build() orders each as
+    // (min, max), radix sorts them in place and fills the CSR core in a
+    // single O(m) pass: sorted edges give every neighbour list in order, so
+    // no per-vertex sort or igraph round trip is needed. Multiple edges and
+    // self loops are kept (as igraph does) unless deduplicate() and
+    // drop_self_loops() are called. Radix passes split over threads (0 =
+    // hardware concurrency) for large edge lists.
+
+    class GraphBuilder {
+
+        int n;
+        int threads;
+        std::vector<std::pair<int, int>> edges;
+        bool sorted = true;
+
+        void check(int a, int b) const {
+            if (a < 0 || b < 0 || a >= n || b >= n) {
+                throw "Vertex out of range.";
+            }
+        }
+
+        void sort();
+
+     public:
+
+        explicit GraphBuilder(int n, int threads = 1) : n(n), threads(threads) {}
+
+        void reserve(std::size_t edges) { this->edges.reserve(edges); }
+
+        void add_edge(int a, int b) {
+            check(a, b);
+            edges.emplace_back(a, b);
+            sorted = false;
+        }
+
+        void add_edges(gsl::span<const std::pair<int, int>> edges);
+        void add_edges(std::vector<std::pair<int, int>>&& edges);
+
+        int vertices() const { return n; }
+        std::size_t size() const { return edges.size(); }
+
+        // Keeps one of each set of parallel edges, returning the number
+        // removed ((a, b) and (b, a) are the same edge).
+        std::size_t deduplicate();
+
+        // Removes self loops, returning the number removed.
+        std::size_t drop_self_loops();
+
+        // The graph of the edges added, leaving the builder empty.
+        UndirectedGraph build();
+
+    };
+
+}
+
+
+#endif
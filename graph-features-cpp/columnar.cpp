@@ -0,0 +1,66 @@
+#include <cstring>
+
+#include "columnar.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+ColumnarWriter::ColumnarWriter(string file_name, vector<string> columns)
+    : out(file_name, ios::binary | ios::trunc), columns(move(columns)) {
+    if (!out.is_open()) {
+        throw "File not open.";
+    }
+    out.write("GFVCOL02", 8);
+    write_u64(this->columns.size());
+    for (const auto& name : this->columns) { write_padded(name, name_width); }
+}
+
+
+void ColumnarWriter::write_u64(uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; i++) { bytes[i] = char((value >> (8 * i)) & 0xff); }
+    out.write(bytes, 8);
+}
+
+
+void ColumnarWriter::write_padded(const string& text, size_t width) {
+    if (text.size() >= width) {
+        throw "Text too long for field.";
+    }
+    string padded(text);
+    padded.resize(width, '\0');
+    out.write(padded.data(), width);
+}
+
+
+void ColumnarWriter::write(const string& instance_id, const vector<gsl::span<const double>>& values) {
+    if (values.size() != columns.size()) {
+        throw "Incorrect number of columns.";
+    }
+    const auto n = values.empty() ? 0 : values[0].size();
+    for (const auto& column : values) {
+        if (column.size() != n) { throw "Columns differ in length."; }
+    }
+    write_u64(instance_id.size());
+    out.write(instance_id.data(), instance_id.size());
+    out.write("\0\0\0\0\0\0\0", (8 - instance_id.size() % 8) % 8);
+    write_u64(n);
+    for (const auto& column : values) {
+        for (const double value : column) {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            write_u64(bits);
+        }
+    }
+    out.flush();
+    if (!out) {
+        throw "Write failed.";
+    }
+}
+
+
+}
@@ -0,0 +1,56 @@
+
+#ifndef COLUMNAR_HPP
+#define COLUMNAR_HPP
+
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gsl/span"
+
+
+namespace graph {
+
+
+    // Writer for per-vertex feature vectors in a binary columnar file. All
+    // integers are little-endian uint64 and values little-endian IEEE 754
+    // doubles, every field 8 byte aligned, so a file can be memory mapped and
+    // each column read in place (e.g. numpy.memmap / frombuffer).
+    //
+    //   file header:  char magic[8] = "GFVCOL02"
+    //                 uint64 column count k
+    //                 char name[32] per column (zero padded)
+    //   per instance: uint64 id length l
+    //                 char id[l], zero padded to a multiple of 8 bytes
+    //                 uint64 vertex count n
+    //                 k columns of n doubles, in header order
+    //
+    // Instance records follow one another; the next record starts at
+    // 16 + 8 ceil(l / 8) + 8 k n bytes past the previous one.
+
+    class ColumnarWriter {
+
+        std::ofstream out;
+        std::vector<std::string> columns;
+
+        void write_u64(uint64_t value);
+        void write_padded(const std::string& text, std::size_t width);
+
+     public:
+
+        static constexpr std::size_t name_width = 32;
+
+        ColumnarWriter(std::string file_name, std::vector<std::string> columns);
+
+        // One instance, with a value column per header column (equal lengths).
+        void write(const std::string& instance_id, const std::vector<gsl::span<const double>>& values);
+
+    };
+
+
+}
+
+
+#endif
@@ -0,0 +1,73 @@
+#include <algorithm>
+
+#include "gsl/gsl_assert"
+#include "compressed.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+void CompressedAdjacency::append_varint(uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(uint8_t(value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(uint8_t(value));
+}
+
+
+void CompressedAdjacency::append_list(int v, vector<uint32_t>& neighbours) {
+    sort(neighbours.begin(), neighbours.end());
+    offsets.push_back(bytes.size());
+    append_varint(neighbours.size());
+    uint32_t previous = v;
+    for (std::size_t i = 0; i < neighbours.size(); i++) {
+        if (i == 0) {
+            int64_t delta = int64_t(neighbours[0]) - v;
+            append_varint((delta >= 0) ? 2 * delta : 2 * (-delta - 1) + 1);
+        } else {
+            append_varint(neighbours[i] - previous);
+        }
+        previous = neighbours[i];
+    }
+    stored += neighbours.size();
+}
+
+
+CompressedAdjacency::CompressedAdjacency(const Adjacency& adj) {
+    const int n = adj.vertices();
+    offsets.reserve(n + 1);
+    vector<uint32_t> list;
+    for (int v = 0; v < n; v++) {
+        auto nbrs = adj.neighbours(v);
+        list.assign(nbrs.begin(), nbrs.end());
+        append_list(v, list);
+    }
+    offsets.push_back(bytes.size());
+    bytes.shrink_to_fit();
+}
+
+
+CompressedAdjacency::CompressedAdjacency(int n, const vector<pair<int, int>>& edges, std::size_t block_entries) {
+
+    vector<std::size_t> degrees(n, 0);
+    for (const auto& [a, b] : edges) {
+        if ((a < 0) || (b < 0) || (a >= n) || (b >= n)) {
+            throw "Vertex out of range.";
+        }
+        if (a == b) { continue; }
+        degrees[a]++;
+        degrees[b]++;
+    }
+
+    *this = from_edges(degrees, [&](auto add) {
+        for (const auto& [a, b] : edges) { add(a, b); }
+    }, block_entries);
+
+}
+
+
+}
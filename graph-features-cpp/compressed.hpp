@@ -0,0 +1,175 @@
+
+#ifndef COMPRESSED_HPP
+#define COMPRESSED_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "gsl/gsl_assert"
+
+#include "adjacency.hpp"
+
+
+namespace graph {
+
+    // Compressed sparse row adjacency for very large graphs. Each vertex's
+    // byte run holds its degree, then its sorted neighbour list as deltas
+    // (the first relative to the vertex itself, zigzag coded for sign), all as
+    // LEB128 varints: 7 bits per byte, high bit set on all but the last byte.
+    // Neighbour lists are sorted, so most deltas fit a single byte. Memory is
+    // one 64 bit offset per vertex plus about 1 - 2 bytes per stored entry,
+    // against 4 bytes per entry for Adjacency (and far more for igraph).
+    //
+    // Same interface as Adjacency for traversal kernels (vertices, entries,
+    // degree, neighbours), with neighbours decoded on the fly by a forward
+    // iterator. Self loops are dropped.
+
+    class CompressedAdjacency {
+
+        std::vector<std::size_t> offsets;
+        std::vector<uint8_t> bytes;
+        std::size_t stored = 0;
+
+        static uint32_t read_varint(const uint8_t*& p) {
+            uint32_t value = *p & 0x7f;
+            for (int shift = 7; *p++ & 0x80; shift += 7) { value |= uint32_t(*p & 0x7f) << shift; }
+            return value;
+        }
+
+        void append_varint(uint64_t value);
+        void append_list(int v, std::vector<uint32_t>& neighbours);
+
+     public:
+
+        class iterator {
+            const uint8_t* p;
+            uint32_t remaining;
+            uint32_t current;
+         public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = uint32_t;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const uint32_t*;
+            using reference = uint32_t;
+            iterator(const uint8_t* p, uint32_t count, uint32_t v) : p(p), remaining(count), current(v) {
+                if (remaining) {
+                    // Zigzag: even deltas are forward, odd are backward.
+                    uint32_t zigzag = read_varint(this->p);
+                    current = (zigzag & 1) ? v - (zigzag >> 1) - 1 : v + (zigzag >> 1);
+                }
+            }
+            uint32_t operator*() const { return current; }
+            iterator& operator++() {
+                if (--remaining) { current += read_varint(p); }
+                return *this;
+            }
+            bool operator!=(const iterator& other) const { return remaining != other.remaining; }
+            bool operator==(const iterator& other) const { return remaining == other.remaining; }
+        };
+
+        class range {
+            const uint8_t* p;
+            uint32_t count;
+            uint32_t v;
+         public:
+            range(const uint8_t* p, uint32_t count, uint32_t v) : p(p), count(count), v(v) {}
+            iterator begin() const { return iterator(p, count, v); }
+            iterator end() const { return iterator(nullptr, 0, v); }
+            std::size_t size() const { return count; }
+        };
+
+        CompressedAdjacency() : offsets(1, 0) {}
+
+        explicit CompressedAdjacency(const Adjacency&);
+
+        // Build from an undirected edge list over vertices 0 .. n-1 without
+        // an uncompressed copy (see from_edges).
+        CompressedAdjacency(int n, const std::vector<std::pair<int, int>>& edges, std::size_t block_entries = 1 << 24);
+
+        // Build from edges replayed by for_each_edge(add), which calls
+        // add(a, b) for every edge, given the vertex degrees they make (self
+        // loops excluded). Vertices are encoded in blocks holding about
+        // block_entries neighbour entries, each gathered by one replay, so the
+        // edges need not be held at all (read_dimacs_compressed rescans the
+        // file instead).
+        template<class ForEachEdge>
+        static CompressedAdjacency from_edges(const std::vector<std::size_t>& degrees, ForEachEdge for_each_edge,
+                                              std::size_t block_entries = 1 << 24);
+
+        int vertices() const { return offsets.size() - 1; }
+        std::size_t entries() const { return stored; }
+        std::size_t memory_bytes() const { return offsets.size() * sizeof(std::size_t) + bytes.size(); }
+
+        int degree(int v) const {
+            const uint8_t* p = bytes.data() + offsets[v];
+            return read_varint(p);
+        }
+
+        range neighbours(int v) const {
+            const uint8_t* p = bytes.data() + offsets[v];
+            uint32_t count = read_varint(p);
+            return range(p, count, v);
+        }
+
+    };
+
+
+    template<class ForEachEdge>
+    CompressedAdjacency CompressedAdjacency::from_edges(const std::vector<std::size_t>& degrees,
+                                                        ForEachEdge for_each_edge, std::size_t block_entries) {
+
+        CompressedAdjacency res;
+        const int n = degrees.size();
+        res.offsets.clear();
+        res.offsets.reserve(n + 1);
+        std::vector<std::size_t> start;
+        std::vector<uint32_t> targets, list;
+        for (int first = 0; first < n; ) {
+
+            // Vertices first .. last - 1 make up this block.
+            int last = first;
+            std::size_t total = 0;
+            while (last < n && (last == first || total + degrees[last] <= block_entries)) {
+                total += degrees[last++];
+            }
+            start.assign(last - first + 1, 0);
+            for (int v = first; v < last; v++) { start[v - first + 1] = start[v - first] + degrees[v]; }
+            targets.resize(total);
+
+            // A replay must give the edges counted in degrees (a file could
+            // change between passes).
+            std::vector<std::size_t> fill(start.begin(), start.end() - 1);
+            auto place = [&](int v, int w) {
+                if (fill[v - first] == start[v - first + 1]) { throw "Edges differ from degrees."; }
+                targets[fill[v - first]++] = w;
+            };
+            for_each_edge([&](int a, int b) {
+                if (a == b) { return; }
+                if (a >= first && a < last) { place(a, b); }
+                if (b >= first && b < last) { place(b, a); }
+            });
+            for (int v = first; v < last; v++) {
+                if (fill[v - first] != start[v - first + 1]) { throw "Edges differ from degrees."; }
+            }
+
+            for (int v = first; v < last; v++) {
+                list.assign(targets.begin() + start[v - first], targets.begin() + start[v - first + 1]);
+                res.append_list(v, list);
+            }
+            first = last;
+        }
+
+        res.offsets.push_back(res.bytes.size());
+        res.bytes.shrink_to_fit();
+        Ensures(res.offsets.size() == std::size_t(n) + 1);
+        return res;
+
+    }
+
+}
+
+
+#endif
@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "gsl/gsl_assert"
+#include "cores.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+CoreDecomposition core_decomposition(const Adjacency& adj) {
+
+    const int n = adj.vertices();
+    CoreDecomposition res;
+    res.core_number.resize(n);
+    res.ordering.resize(n);
+    if (n == 0) { return res; }
+
+    // Counting sort by degree: vertices[start[d] ..] have remaining degree d.
+    vector<int> remaining(n), vertices(n), position(n);
+    int max_degree = 0;
+    for (int v = 0; v < n; v++) {
+        remaining[v] = adj.degree(v);
+        max_degree = max(max_degree, remaining[v]);
+    }
+    vector<int> start(max_degree + 2, 0);
+    for (int v = 0; v < n; v++) { start[remaining[v] + 1]++; }
+    for (int d = 0; d <= max_degree; d++) { start[d + 1] += start[d]; }
+    vector<int> fill(start.begin(), start.end() - 1);
+    for (int v = 0; v < n; v++) {
+        position[v] = fill[remaining[v]]++;
+        vertices[position[v]] = v;
+    }
+
+    // Removing v lowers each later neighbour u by one: swap u to the front of
+    // its bucket and move the bucket boundary past it.
+    for (int i = 0; i < n; i++) {
+        const int v = vertices[i];
+        res.core_number[v] = remaining[v];
+        res.ordering[n - 1 - i] = v;
+        for (const auto u : adj.neighbours(v)) {
+            if (remaining[u] <= remaining[v]) { continue; }
+            const int du = remaining[u];
+            const int front = vertices[start[du]];
+            if (front != (int) u) {
+                swap(vertices[start[du]], vertices[position[u]]);
+                position[front] = position[u];
+                position[u] = start[du];
+            }
+            start[du]++;
+            remaining[u]--;
+        }
+    }
+
+    res.degeneracy = *max_element(res.core_number.begin(), res.core_number.end());
+    return res;
+}
+
+
+vector<int> greedy_colouring(const Adjacency& adj, gsl::span<const int> order) {
+
+    const int n = adj.vertices();
+    Expects(order.size() == n);
+
+    // used[c] == v marks colour c as taken by a neighbour of v.
+    vector<int> colour(n, -1), used(n + 1, -1);
+    for (const int v : order) {
+        for (const auto u : adj.neighbours(v)) {
+            if (colour[u] >= 0) { used[colour[u]] = v; }
+        }
+        int c = 0;
+        while (used[c] == v) { c++; }
+        colour[v] = c;
+    }
+
+    return colour;
+}
+
+
+}
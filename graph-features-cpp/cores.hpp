@@ -0,0 +1,41 @@
+
+#ifndef CORES_HPP
+#define CORES_HPP
+
+
+#include <vector>
+
+#include "gsl/span"
+
+#include "adjacency.hpp"
+
+
+namespace graph {
+
+
+    // Core decomposition by repeatedly removing a vertex of minimum remaining
+    // degree (Batagelj & Zaversnik 2003), with vertices kept in degree order
+    // and bucket boundaries so every removal and degree update is O(1): O(n + m)
+    // overall. The core number of a vertex is its remaining degree when it is
+    // removed, and the degeneracy is the largest core number.
+    //
+    // The smallest-last ordering is the reverse of the removal order: each
+    // vertex has at most degeneracy neighbours before it, so greedy colouring
+    // in this order uses at most degeneracy + 1 colours.
+    struct CoreDecomposition {
+        int degeneracy = 0;
+        std::vector<int> core_number;
+        std::vector<int> ordering;
+    };
+
+    CoreDecomposition core_decomposition(const Adjacency&);
+
+    // Greedy colouring: each vertex in order takes the smallest colour (from 0)
+    // not used by a neighbour already coloured. Returns the colour of each vertex.
+    std::vector<int> greedy_colouring(const Adjacency&, gsl::span<const int> order);
+
+
+}
+
+
+#endif
@@ -0,0 +1,153 @@
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <utility>
+
+#include "costmodel.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    // Timings below this are clock noise.
+    const double min_seconds = 1e-7;
+
+    void covariates(int vertices, double edges, double x[3]) {
+        x[0] = 1.0;
+        x[1] = log(max(1, vertices));
+        x[2] = log(edges + 1);
+    }
+
+    // Solves A b = y (3 x 3) by Gaussian elimination with partial pivoting,
+    // false if A is singular.
+    bool solve(double A[3][3], double y[3], double b[3]) {
+        for (int c = 0; c < 3; c++) {
+            int pivot = c;
+            for (int r = c + 1; r < 3; r++) {
+                if (fabs(A[r][c]) > fabs(A[pivot][c])) { pivot = r; }
+            }
+            if (fabs(A[pivot][c]) < 1e-12) { return false; }
+            swap(A[c], A[pivot]);
+            swap(y[c], y[pivot]);
+            for (int r = c + 1; r < 3; r++) {
+                const double f = A[r][c] / A[c][c];
+                for (int k = c; k < 3; k++) { A[r][k] -= f * A[c][k]; }
+                y[r] -= f * y[c];
+            }
+        }
+        for (int c = 2; c >= 0; c--) {
+            b[c] = y[c];
+            for (int k = c + 1; k < 3; k++) { b[c] -= A[c][k] * b[k]; }
+            b[c] /= A[c][c];
+        }
+        return true;
+    }
+
+}
+
+
+CostModel::CostModel(const string& file_name) {
+    ifstream in(file_name);
+    string line;
+    while (getline(in, line)) {
+        if (line.empty() || line[0] == '#') { continue; }
+        istringstream fields(line);
+        string name;
+        Fit fit;
+        fields >> name >> fit.count;
+        for (int i = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++) {
+                fields >> fit.xx[i][j];
+                fit.xx[j][i] = fit.xx[i][j];
+            }
+        }
+        for (int i = 0; i < 3; i++) { fields >> fit.xy[i]; }
+        if (!fields) {
+            throw "Malformed cost model.";
+        }
+        fits[name] = fit;
+    }
+}
+
+
+void CostModel::save(const string& file_name) const {
+    ofstream out(file_name);
+    if (!out.is_open()) {
+        throw "File not open.";
+    }
+    out << "# name count xx00 xx01 xx02 xx11 xx12 xx22 xy0 xy1 xy2" << endl;
+    out << setprecision(17);
+    for (const auto& [name, fit] : fits) {
+        out << name << " " << fit.count;
+        for (int i = 0; i < 3; i++) {
+            for (int j = i; j < 3; j++) { out << " " << fit.xx[i][j]; }
+        }
+        for (int i = 0; i < 3; i++) { out << " " << fit.xy[i]; }
+        out << endl;
+    }
+}
+
+
+void CostModel::observe(const string& name, int vertices, double edges, double seconds) {
+    double x[3];
+    covariates(vertices, edges, x);
+    const double y = log(max(seconds, min_seconds));
+    Fit& fit = fits[name];
+    fit.count++;
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) { fit.xx[i][j] += x[i] * x[j]; }
+        fit.xy[i] += x[i] * y;
+    }
+}
+
+
+void CostModel::add(const CostModel& other) {
+    for (const auto& [name, theirs] : other.fits) {
+        Fit& fit = fits[name];
+        fit.count += theirs.count;
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) { fit.xx[i][j] += theirs.xx[i][j]; }
+            fit.xy[i] += theirs.xy[i];
+        }
+    }
+}
+
+
+double CostModel::predict(const string& name, int vertices, double edges) const {
+    const auto found = fits.find(name);
+    if (found == fits.end() || found->second.count == 0) {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    const Fit& fit = found->second;
+
+    // A small ridge on the exponents keeps the fit defined until samples
+    // span a range of sizes (it then tends to the mean time).
+    double A[3][3], y[3], b[3];
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) { A[i][j] = fit.xx[i][j]; }
+        A[i][i] += (i > 0) ? 1e-6 * fit.count : 0.0;
+        y[i] = fit.xy[i];
+    }
+    if (!solve(A, y, b)) {
+        return numeric_limits<double>::quiet_NaN();
+    }
+    double x[3];
+    covariates(vertices, edges, x);
+    return exp(b[0] * x[0] + b[1] * x[1] + b[2] * x[2]);
+}
+
+
+int CostModel::samples(const string& name) const {
+    const auto found = fits.find(name);
+    return (found == fits.end()) ? 0 : found->second.count;
+}
+
+
+}
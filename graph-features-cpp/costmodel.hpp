@@ -0,0 +1,57 @@
+#ifndef COSTMODEL_HPP
+#define COSTMODEL_HPP
+
+
+#include <map>
+#include <string>
+
+
+namespace graph {
+
+
+    // Runtime model for named features, fitted on this host from observed
+    // timings. Each name has a power law in graph size,
+    //
+    //     log seconds = b0 + b1 log n + b2 log (m + 1),
+    //
+    // fitted by least squares (density is determined by n and m, so it adds
+    // no covariate). Only the normal equation sums are kept, so new
+    // observations are added to a loaded model and the file stays small: one
+    // text line per name.
+
+    class CostModel {
+
+        struct Fit {
+            double count = 0.0;
+            double xx[3][3] = {};
+            double xy[3] = {};
+        };
+
+        std::map<std::string, Fit> fits;
+
+     public:
+
+        CostModel() = default;
+
+        // Loads a saved model; a file that does not exist gives an empty model.
+        explicit CostModel(const std::string& file_name);
+
+        void save(const std::string& file_name) const;
+
+        void observe(const std::string& name, int vertices, double edges, double seconds);
+
+        // Adds the observations of another model.
+        void add(const CostModel& other);
+
+        // Predicted seconds, or NaN if name has not been observed.
+        double predict(const std::string& name, int vertices, double edges) const;
+
+        int samples(const std::string& name) const;
+
+    };
+
+
+}
+
+
+#endif
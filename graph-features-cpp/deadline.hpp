@@ -0,0 +1,48 @@
+#ifndef DEADLINE_HPP
+#define DEADLINE_HPP
+
+
+#include <chrono>
+
+
+namespace graph {
+
+
+    // Thrown by Deadline::check once the deadline has passed.
+    struct Cancelled {};
+
+    // Cooperative cancellation of long kernels. Kernels taking a Deadline call
+    // check() between units of work (a BFS source, a matrix row), so they
+    // stop soon after it passes; the partial work is discarded. The default
+    // deadline never passes.
+
+    class Deadline {
+
+        using Clock = std::chrono::steady_clock;
+
+        Clock::time_point at = Clock::time_point::max();
+
+     public:
+
+        Deadline() = default;
+
+        // Seconds from now; infinite (or years) never passes.
+        explicit Deadline(double seconds) {
+            if (seconds < 1e8) {
+                at = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+            }
+        }
+
+        bool passed() const { return at != Clock::time_point::max() && Clock::now() >= at; }
+
+        void check() const {
+            if (passed()) { throw Cancelled(); }
+        }
+
+    };
+
+
+}
+
+
+#endif
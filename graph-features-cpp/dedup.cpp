@@ -0,0 +1,86 @@
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <map>
+
+#include "graph.hpp"
+
+using namespace std;
+using namespace graph;
+
+
+int main(int argc, char *argv[]) {
+
+    // Arguments are DIMACS files or directories (scanned for .col files).
+    // --identical: group only identical graphs (the same edges on the same
+    // vertex numbering, in any order) instead of equal WL fingerprints.
+    int iterations = 3;
+    bool identical = false;
+    vector<string> instance_files;
+    for (int i = 1; i < argc; i++) {
+        string arg(argv[i]);
+        if (arg == "--iterations" && i + 1 < argc) {
+            iterations = stoi(argv[++i]);
+            if (iterations < 0) {
+                cerr << "Iterations must not be negative" << endl;
+                return 1;
+            }
+        } else if (arg == "--identical") {
+            identical = true;
+        } else if (filesystem::is_directory(arg)) {
+            vector<string> found;
+            for (const auto& entry : filesystem::directory_iterator(arg)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".col") {
+                    found.push_back(entry.path().string());
+                }
+            }
+            sort(found.begin(), found.end());
+            instance_files.insert(instance_files.end(), found.begin(), found.end());
+        } else {
+            instance_files.push_back(arg);
+        }
+    }
+
+    map<Hash128, vector<string>> groups;
+    for (const auto& instance_file : instance_files) {
+        try {
+            const UndirectedGraph g = read_dimacs(instance_file);
+            groups[identical ? canonical_hash(g) : wl_fingerprint(g, iterations)].push_back(instance_file);
+        } catch (...) {
+            cerr << "Skipped " << instance_file << " due to error" << endl;
+        }
+    }
+
+    // Groups of two or more files with the same fingerprint, first file first.
+    // Identical groups are confirmed edge by edge, rereading the files so
+    // only two graphs are held at once; a hash collision splits a group.
+    int duplicates = 0, duplicate_groups = 0;
+    for (auto [fingerprint, members] : groups) {
+        while (members.size() >= 2) {
+            vector<string> group{members.front()}, rest;
+            if (identical) {
+                const UndirectedGraph first = read_dimacs(members.front());
+                const auto first_edges = canonical_edges(first);
+                for (auto it = members.begin() + 1; it != members.end(); ++it) {
+                    const UndirectedGraph g = read_dimacs(*it);
+                    const bool same = g.vertices() == first.vertices() && canonical_edges(g) == first_edges;
+                    (same ? group : rest).push_back(*it);
+                }
+            } else {
+                group = members;
+            }
+            if (group.size() >= 2) {
+                cout << "===== " << fingerprint.hex() << " =====" << endl;
+                for (const auto& instance_file : group) { cout << instance_file << endl; }
+                duplicates += group.size() - 1;
+                duplicate_groups++;
+            }
+            members = rest;
+        }
+    }
+    cerr << instance_files.size() << " files, " << duplicate_groups << " duplicate groups, "
+         << duplicates << " duplicates" << endl;
+
+    return 0;
+
+}
@@ -0,0 +1,788 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <type_traits>
+#include <thread>
+
+#include "gsl/gsl_assert"
+#include "distance.hpp"
+#include "parallel.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+template<class Graph>
+BasicBreadthFirstSearch<Graph>::BasicBreadthFirstSearch(const Graph& adj)
+    : adj(adj), dist(adj.vertices(), -1), queue(adj.vertices()),
+      frontier((adj.vertices() + 63) / 64), unvisited((adj.vertices() + 63) / 64) {}
+
+
+template<class Graph>
+int BasicBreadthFirstSearch<Graph>::run(int source, int max_depth) {
+
+    const int n = adj.vertices();
+    const int words = unvisited.size();
+    for (std::size_t i = 0; i < reached; i++) { dist[queue[i]] = -1; }
+    fill(unvisited.begin(), unvisited.end(), ~uint64_t(0));
+    if (n % 64) { unvisited[words - 1] = (uint64_t(1) << (n % 64)) - 1; }
+
+    auto visit = [&](int v, int d) {
+        dist[v] = d;
+        unvisited[v / 64] &= ~(uint64_t(1) << (v % 64));
+        queue[reached++] = v;
+    };
+
+    reached = 0;
+    visit(source, 0);
+    level_start.assign({0, 1});
+
+    // Edges incident to the frontier and to unvisited vertices.
+    double frontier_edges = adj.degree(source);
+    double unvisited_edges = adj.entries() - frontier_edges;
+    bool bottom_up = false;
+
+    int depth = 0;
+    for (; depth < max_depth; depth++) {
+
+        const int begin = level_start[depth], end = level_start[depth + 1];
+        if (!bottom_up && frontier_edges > unvisited_edges / alpha) {
+            bottom_up = true;
+        } else if (bottom_up && end - begin < n / beta) {
+            bottom_up = false;
+        }
+
+        if (bottom_up) {
+            fill(frontier.begin(), frontier.end(), 0);
+            for (int i = begin; i < end; i++) {
+                frontier[queue[i] / 64] |= uint64_t(1) << (queue[i] % 64);
+            }
+            for (int word = 0; word < words; word++) {
+                for (uint64_t bits = unvisited[word]; bits; bits &= bits - 1) {
+                    const int v = word * 64 + __builtin_ctzll(bits);
+                    for (const auto u : adj.neighbours(v)) {
+                        if (frontier[u / 64] & (uint64_t(1) << (u % 64))) {
+                            visit(v, depth + 1);
+                            break;
+                        }
+                    }
+                }
+            }
+        } else {
+            for (int i = begin; i < end; i++) {
+                for (const auto w : adj.neighbours(queue[i])) {
+                    if (dist[w] < 0) { visit(w, depth + 1); }
+                }
+            }
+        }
+
+        if ((int) reached == end) { break; }
+        level_start.push_back(reached);
+        frontier_edges = 0;
+        for (std::size_t i = end; i < reached; i++) { frontier_edges += adj.degree(queue[i]); }
+        unvisited_edges -= frontier_edges;
+    }
+
+    return depth;
+}
+
+
+template class BasicBreadthFirstSearch<Adjacency>;
+template class BasicBreadthFirstSearch<CompressedAdjacency>;
+
+
+EccentricityBounds eccentricity_bounds(const Adjacency& adj, bool resolve_all) {
+
+    const int n = adj.vertices();
+    const int unbounded = numeric_limits<int>::max();
+
+    EccentricityBounds res;
+    res.lower.assign(n, 0);
+    res.upper.assign(n, unbounded);
+    if (n == 0) { return res; }
+
+    // Vertices whose eccentricity is not yet pinned down.
+    vector<int> candidates(n);
+    for (int v = 0; v < n; v++) { candidates[v] = v; }
+
+    BreadthFirstSearch bfs(adj);
+    const auto& dist = bfs.distances();
+    int diameter_lower = 0, radius_upper = unbounded;
+    bool pick_upper = true;
+
+    while (!candidates.empty()) {
+
+        // Global bounds: pruned/resolved vertices cannot extend these.
+        int diameter_upper = diameter_lower, radius_lower = radius_upper;
+        for (const int w : candidates) {
+            diameter_upper = max(diameter_upper, res.upper[w]);
+            radius_lower = min(radius_lower, res.lower[w]);
+        }
+        if (!resolve_all && (diameter_lower == diameter_upper) && (radius_lower == radius_upper)) {
+            break;
+        }
+
+        // Alternate between largest upper and smallest lower bound,
+        // breaking ties by degree.
+        int source = candidates[0];
+        for (const int w : candidates) {
+            bool better;
+            if (pick_upper) {
+                better = (res.upper[w] > res.upper[source]) ||
+                    ((res.upper[w] == res.upper[source]) && (adj.degree(w) > adj.degree(source)));
+            } else {
+                better = (res.lower[w] < res.lower[source]) ||
+                    ((res.lower[w] == res.lower[source]) && (adj.degree(w) > adj.degree(source)));
+            }
+            if (better) { source = w; }
+        }
+        pick_upper = !pick_upper;
+
+        int ecc = bfs.run(source);
+        res.bfs_runs++;
+        res.lower[source] = res.upper[source] = ecc;
+        diameter_lower = max(diameter_lower, ecc);
+        radius_upper = min(radius_upper, ecc);
+
+        // Tighten bounds within the source's component and drop resolved
+        // (or, when only extremes are needed, irrelevant) vertices.
+        auto removed = remove_if(candidates.begin(), candidates.end(), [&](int w) {
+            if (dist[w] >= 0) {
+                res.lower[w] = max(res.lower[w], max(dist[w], ecc - dist[w]));
+                res.upper[w] = min(res.upper[w], ecc + dist[w]);
+            }
+            if (res.lower[w] == res.upper[w]) { return true; }
+            return !resolve_all && (res.upper[w] <= diameter_lower) && (res.lower[w] >= radius_upper);
+        });
+        candidates.erase(removed, candidates.end());
+    }
+
+    res.diameter = diameter_lower;
+    res.radius = radius_upper;
+
+    Ensures(res.diameter >= res.radius);
+    return res;
+}
+
+
+namespace {
+
+    // Running sums for one degree stratum: row sum S and reachable count R
+    // of each sampled source.
+    struct Stratum {
+        vector<int> pool;
+        double n = 0, s = 0, ss = 0, r = 0, rr = 0, sr = 0;
+
+        void add(double row_sum, double reachable) {
+            n += 1;
+            s += row_sum;               ss += row_sum * row_sum;
+            r += reachable;             rr += reachable * reachable;
+            sr += row_sum * reachable;
+        }
+
+        // Contribution N^2 (1 - n/N) var / n to the variance of an estimated
+        // total of S - a * R over this stratum.
+        double total_variance(double a) const {
+            double N = pool.size();
+            if (n >= N) { return 0.0; }
+            double var_s = (ss - s * s / n) / (n - 1);
+            double var_r = (rr - r * r / n) / (n - 1);
+            double cov_sr = (sr - s * r / n) / (n - 1);
+            double var = max(0.0, var_s - 2 * a * cov_sr + a * a * var_r);
+            return N * N * (1 - n / N) * var / n;
+        }
+    };
+
+}
+
+
+PathLengthEstimate sample_path_lengths(const Adjacency& adj, double relative_error, unsigned seed) {
+
+    const int n = adj.vertices();
+    PathLengthEstimate res;
+    if (n < 2) { return res; }
+
+    // Equal sized strata over the degree ordering, each shuffled.
+    vector<int> order(n);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return adj.degree(a) < adj.degree(b); });
+
+    mt19937 rng(seed);
+    vector<Stratum> strata(max(1, min(8, n / 8)));
+    for (std::size_t h = 0; h < strata.size(); h++) {
+        strata[h].pool.assign(order.begin() + h * n / strata.size(), order.begin() + (h + 1) * n / strata.size());
+        shuffle(strata[h].pool.begin(), strata[h].pool.end(), rng);
+    }
+
+    BreadthFirstSearch bfs(adj);
+    for (int round = 0; res.sources < n; round++) {
+
+        for (auto& stratum : strata) {
+            if (round >= (int) stratum.pool.size()) { continue; }
+            bfs.run(stratum.pool[round]);
+            double row_sum = 0, reachable = 0;
+            for (const int d : bfs.distances()) {
+                if (d > 0) { row_sum += d; reachable += 1; }
+            }
+            stratum.add(row_sum, reachable);
+            res.sources++;
+        }
+
+        // Variance estimates from fewer samples per stratum are too noisy
+        // to stop on.
+        if (round < 3 && res.sources < n) { continue; }
+
+        // Stratified totals of S and R; average path length is their ratio.
+        double total_s = 0, total_r = 0;
+        for (const auto& stratum : strata) {
+            total_s += stratum.pool.size() * stratum.s / stratum.n;
+            total_r += stratum.pool.size() * stratum.r / stratum.n;
+        }
+        double apl = (total_r > 0) ? total_s / total_r : numeric_limits<double>::quiet_NaN();
+        double var_s = 0, var_z = 0;
+        for (const auto& stratum : strata) {
+            var_s += stratum.total_variance(0.0);
+            var_z += (total_r > 0) ? stratum.total_variance(apl) : 0.0;
+        }
+
+        // Each unordered pair appears twice in the total of row sums.
+        res.wiener_index.value = total_s / 2;
+        res.wiener_index.standard_error = sqrt(var_s) / 2;
+        res.average_path_length.value = apl;
+        res.average_path_length.standard_error = (total_r > 0) ? sqrt(var_z) / total_r : 0.0;
+
+        if ((res.wiener_index.standard_error <= relative_error * res.wiener_index.value) &&
+                (total_r == 0 || res.average_path_length.standard_error <= relative_error * apl)) {
+            break;
+        }
+    }
+
+    return res;
+}
+
+
+namespace {
+
+    // Szeged and revised Szeged indices from one distance row per source w,
+    // returned by row_of(w) for a per-thread row_of = make_rows(). For every
+    // edge (u, v) count whether w is strictly closer to u or to v. Entries are
+    // compared as unsigned so that unreachable markers (-1 or the matrix
+    // maximum) are the largest.
+    template<class T, class MakeRows>
+    pair<double, double> szeged_fold(const Adjacency& adj, int threads, MakeRows make_rows,
+                                     const Deadline& deadline = {}) {
+
+        const int n = adj.vertices();
+        if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+
+        // Each edge once, as (u, v) with u < v.
+        vector<pair<uint32_t, uint32_t>> edges;
+        edges.reserve(adj.entries() / 2);
+        for (int u = 0; u < n; u++) {
+            for (const auto v : adj.neighbours(u)) {
+                if ((int) v > u) { edges.emplace_back(u, v); }
+            }
+        }
+
+        // Per-thread counts of vertices strictly closer to u (n_uv) or v (n_vu).
+        vector<vector<uint32_t>> closer_u(threads), closer_v(threads);
+
+        parallel_ranges(n, threads, [&](int t, int begin, int end) {
+            auto& n_uv = closer_u[t];
+            auto& n_vu = closer_v[t];
+            n_uv.assign(edges.size(), 0);
+            n_vu.assign(edges.size(), 0);
+            auto row_of = make_rows();
+            for (int w = begin; w < end; w++) {
+                deadline.check();
+                const vector<T>& row = row_of(w);
+                for (std::size_t e = 0; e < edges.size(); e++) {
+                    make_unsigned_t<T> du = row[edges[e].first];
+                    make_unsigned_t<T> dv = row[edges[e].second];
+                    n_uv[e] += du < dv;
+                    n_vu[e] += dv < du;
+                }
+            }
+        });
+
+        // Vertices other than u and v that are not strictly closer to either
+        // endpoint are equidistant.
+        double szeged = 0, revised_szeged = 0;
+        for (std::size_t e = 0; e < edges.size(); e++) {
+            double n_uv = 0, n_vu = 0;
+            for (int t = 0; t < threads; t++) {
+                if (closer_u[t].empty()) { continue; }
+                n_uv += closer_u[t][e];
+                n_vu += closer_v[t][e];
+            }
+            // Exclude the endpoints themselves (w = u counts as closer to u).
+            n_uv -= 1;
+            n_vu -= 1;
+            double o_uv = n - 2 - n_uv - n_vu;
+            szeged += n_uv * n_vu;
+            revised_szeged += (n_uv + o_uv / 2) * (n_vu + o_uv / 2);
+        }
+
+        return make_pair(szeged, revised_szeged);
+    }
+
+    // Upper bound on the diameter: twice the eccentricity of the first vertex
+    // found in each connected component.
+    int diameter_upper_bound(const Adjacency& adj) {
+        const int n = adj.vertices();
+        vector<int> dist(n, -1), queue(n);
+        int bound = 0;
+        for (int root = 0; root < n; root++) {
+            if (dist[root] >= 0) { continue; }
+            int head = 0, tail = 0;
+            dist[root] = 0;
+            queue[tail++] = root;
+            while (head < tail) {
+                int u = queue[head++];
+                for (const auto w : adj.neighbours(u)) {
+                    if (dist[w] < 0) {
+                        dist[w] = dist[u] + 1;
+                        queue[tail++] = w;
+                    }
+                }
+            }
+            bound = max(bound, 2 * dist[queue[tail - 1]]);
+        }
+        return bound;
+    }
+
+    // Levels of a multi-source BFS from sources first .. first + count - 1
+    // (count <= 64), calling visit(source, v, d) once for each reached pair.
+    // Each level pulls the frontier bits of every vertex's neighbours.
+    template<class Visit>
+    void multi_source_layers(const Adjacency& adj, int first, int count, vector<uint64_t>& seen,
+                             vector<uint64_t>& frontier, vector<uint64_t>& next, Visit visit) {
+        const int n = adj.vertices();
+        fill(seen.begin(), seen.end(), 0);
+        fill(frontier.begin(), frontier.end(), 0);
+        for (int s = 0; s < count; s++) {
+            seen[first + s] = frontier[first + s] = uint64_t(1) << s;
+        }
+        for (int d = 1; ; d++) {
+            bool grown = false;
+            for (int v = 0; v < n; v++) {
+                uint64_t reached = 0;
+                for (const auto u : adj.neighbours(v)) { reached |= frontier[u]; }
+                next[v] = reached & ~seen[v];
+                if (next[v]) {
+                    grown = true;
+                    seen[v] |= next[v];
+                    for (uint64_t b = next[v]; b; b &= b - 1) { visit(first + __builtin_ctzll(b), v, d); }
+                }
+            }
+            if (!grown) { return; }
+            swap(frontier, next);
+        }
+    }
+
+}
+
+
+double wiener_index_streaming(const Adjacency& adj, int threads) {
+
+    const int n = adj.vertices();
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    vector<double> partial(max(1, threads), 0.0);
+    vector<char> unconnected(max(1, threads), false);
+
+    parallel_ranges(n, threads, [&](int t, int begin, int end) {
+        BreadthFirstSearch bfs(adj);
+        const auto& dist = bfs.distances();
+        for (int s = begin; s < end; s++) {
+            bfs.run(s);
+            // Each unordered pair is counted from its lower numbered end.
+            for (int j = s + 1; j < n; j++) {
+                if (dist[j] < 0) { unconnected[t] = true; break; }
+                partial[t] += dist[j];
+            }
+            if (unconnected[t]) { return; }
+        }
+    });
+
+    for (const char u : unconnected) {
+        if (u) { return numeric_limits<double>::infinity(); }
+    }
+    double result = 0.0;
+    for (const double p : partial) { result += p; }
+    return result;
+}
+
+
+pair<double, double> szeged_indices_streaming(const Adjacency& adj, int threads) {
+    return szeged_fold<int>(adj, threads, [&]() {
+        return [bfs = BreadthFirstSearch(adj)](int w) mutable -> const vector<int>& {
+            bfs.run(w);
+            return bfs.distances();
+        };
+    });
+}
+
+
+DistanceMatrix::DistanceMatrix(const Adjacency& adj, int threads, const Deadline& deadline) : n(adj.vertices()) {
+
+    // 8 bit entries (255 = unreachable) suffice if the diameter is at most 254.
+    // Twice the eccentricity of one vertex per component bounds it cheaply;
+    // fall back to the exact diameter only when that bound is too loose.
+    const int bound = diameter_upper_bound(adj);
+    if (bound >= UINT8_MAX) {
+        int diameter = eccentricity_bounds(adj, false).diameter;
+        if (diameter >= UINT16_MAX) { throw "Distance exceeds matrix range."; }
+        is_wide = diameter >= UINT8_MAX;
+    }
+
+    const bool bit_parallel = prefer_bit_parallel(adj) && bound < 64;
+    auto fill = [&](auto& data, auto unreachable) {
+        if (bit_parallel) {
+            data.assign(offset(n), unreachable);
+            const int blocks = (n + 63) / 64;
+            parallel_ranges(blocks, threads, [&](int, int begin, int end) {
+                vector<uint64_t> seen(n), frontier(n), next(n);
+                for (int block = begin; block < end; block++) {
+                    deadline.check();
+                    multi_source_layers(adj, block * 64, min(64, n - block * 64), seen, frontier, next,
+                        [&](int source, int v, int d) {
+                            if (v < source) { data[offset(source) + v] = d; }
+                        });
+                }
+            });
+            return;
+        }
+        data.resize(offset(n));
+        parallel_ranges(n, threads, [&](int, int begin, int end) {
+            BreadthFirstSearch bfs(adj);
+            const auto& dist = bfs.distances();
+            for (int i = begin; i < end; i++) {
+                deadline.check();
+                bfs.run(i);
+                for (int j = 0; j < i; j++) {
+                    data[offset(i) + j] = (dist[j] < 0) ? unreachable : dist[j];
+                }
+            }
+        });
+    };
+    if (is_wide) {
+        fill(wide_storage, uint16_t(UINT16_MAX));
+    } else {
+        fill(narrow, uint8_t(UINT8_MAX));
+    }
+}
+
+
+namespace {
+
+    template<class T>
+    double wiener_sum(gsl::span<const T> entries) {
+        // Single contiguous pass; vectorises to widening adds and a max.
+        uint64_t total = 0;
+        T largest = 0;
+        for (const T d : entries) {
+            total += d;
+            largest = max(largest, d);
+        }
+        if (largest == numeric_limits<T>::max()) { return numeric_limits<double>::infinity(); }
+        return total;
+    }
+
+    template<class T>
+    pair<double, double> szeged_from_matrix(const Adjacency& adj, const DistanceMatrix& distance, int threads,
+                                            const Deadline& deadline) {
+        return szeged_fold<T>(adj, threads, [&]() {
+            return [&distance, row = vector<T>()](int w) mutable -> const vector<T>& {
+                distance.row<T>(w, row);
+                return row;
+            };
+        }, deadline);
+    }
+
+}
+
+
+bool prefer_bit_parallel(const Adjacency& adj) {
+    const double n = adj.vertices();
+    return (n > 1) && (64 * double(adj.entries()) >= n * (n - 1));
+}
+
+
+double wiener_index(const DistanceMatrix& distance) {
+    return distance.wide() ? wiener_sum(distance.entries<uint16_t>()) : wiener_sum(distance.entries<uint8_t>());
+}
+
+
+double average_path_length(const DistanceMatrix& distance) {
+    auto mean = [](auto entries) {
+        using T = typename decltype(entries)::value_type;
+        uint64_t total = 0, reachable = 0;
+        for (const T d : entries) {
+            const bool counted = d != numeric_limits<T>::max();
+            total += counted ? d : 0;
+            reachable += counted;
+        }
+        return (reachable > 0) ? double(total) / reachable : numeric_limits<double>::quiet_NaN();
+    };
+    return distance.wide() ? mean(distance.entries<uint16_t>()) : mean(distance.entries<uint8_t>());
+}
+
+
+int diameter(const DistanceMatrix& distance) {
+    auto longest = [](auto entries) {
+        using T = typename decltype(entries)::value_type;
+        int res = 0;
+        for (const T d : entries) {
+            if (d != numeric_limits<T>::max()) { res = max<int>(res, d); }
+        }
+        return res;
+    };
+    return distance.wide() ? longest(distance.entries<uint16_t>()) : longest(distance.entries<uint8_t>());
+}
+
+
+vector<int> eccentricities(const DistanceMatrix& distance) {
+    auto longest = [&](auto tag) {
+        using T = decltype(tag);
+        vector<int> res(distance.vertices(), 0);
+        for (int i = 0; i < distance.vertices(); i++) {
+            const auto row = distance.lower_row<T>(i);
+            for (int j = 0; j < i; j++) {
+                const T d = row[j];
+                if (d == numeric_limits<T>::max()) { continue; }
+                res[i] = max<int>(res[i], d);
+                res[j] = max<int>(res[j], d);
+            }
+        }
+        return res;
+    };
+    return distance.wide() ? longest(uint16_t()) : longest(uint8_t());
+}
+
+
+pair<double, double> szeged_indices(const Adjacency& adj, const DistanceMatrix& distance, int threads,
+                                   const Deadline& deadline) {
+    Expects(adj.vertices() == distance.vertices());
+    return distance.wide() ?
+        szeged_from_matrix<uint16_t>(adj, distance, threads, deadline) :
+        szeged_from_matrix<uint8_t>(adj, distance, threads, deadline);
+}
+
+
+namespace {
+
+    uint64_t bit(int v) { return uint64_t(1) << (v % 64); }
+
+    int popcount(uint64_t word) { return __builtin_popcountll(word); }
+
+}
+
+
+DiameterTwo::DiameterTwo(const Adjacency& adj)
+    : n(adj.vertices()), words((n + 63) / 64), bits(n * words, 0) {
+    for (int v = 0; v < n; v++) {
+        uint64_t* r = bits.data() + v * words;
+        r[v / 64] |= bit(v);
+        for (const auto u : adj.neighbours(v)) { r[u / 64] |= bit(u); }
+    }
+}
+
+
+int DiameterTwo::closed_degree(int v) const {
+    int count = 0;
+    for (const auto word : row(v)) { count += popcount(word); }
+    return count;
+}
+
+
+optional<DiameterTwo> DiameterTwo::prove(const Adjacency& adj) {
+
+    const int n = adj.vertices();
+    if (n < 2 || n > max_vertices) { return nullopt; }
+
+    // Walks of length at most 2 from v reach at most this many vertices.
+    for (int v = 0; v < n; v++) {
+        long reach = 1 + adj.degree(v);
+        for (const auto u : adj.neighbours(v)) { reach += adj.degree(u) - 1; }
+        if (reach < n) { return nullopt; }
+    }
+
+    DiameterTwo res(adj);
+    for (int v = 0; v < n; v++) {
+        if (res.closed_degree(v) != adj.degree(v) + 1) { return nullopt; }
+    }
+
+    const uint64_t last = (n % 64) ? bit(n) - 1 : ~uint64_t(0);
+    vector<uint64_t> reached(res.words);
+    for (int v = 0; v < n; v++) {
+        const auto own = res.row(v);
+        copy(own.begin(), own.end(), reached.begin());
+        for (const auto u : adj.neighbours(v)) {
+            const auto other = res.row(u);
+            for (std::size_t i = 0; i < res.words; i++) { reached[i] |= other[i]; }
+        }
+        for (std::size_t i = 0; i + 1 < res.words; i++) {
+            if (~reached[i]) { return nullopt; }
+        }
+        if (reached[res.words - 1] != last) { return nullopt; }
+    }
+
+    return res;
+}
+
+
+double DiameterTwo::wiener_index() const {
+    double edges = 0;
+    for (int v = 0; v < n; v++) { edges += closed_degree(v) - 1; }
+    edges /= 2;
+    // Every non-adjacent pair is at distance 2.
+    return double(n) * (n - 1) - edges;
+}
+
+
+pair<double, double> DiameterTwo::szeged_indices(const Deadline& deadline) const {
+    double szeged = 0, revised_szeged = 0;
+    for (int u = 0; u < n; u++) {
+        deadline.check();
+        const auto ru = row(u);
+        for (std::size_t word = u / 64; word < words; word++) {
+            for (uint64_t b = ru[word]; b; b &= b - 1) {
+                const int v = word * 64 + __builtin_ctzll(b);
+                if (v <= u) { continue; }
+                const auto rv = row(v);
+                double n_uv = 0, n_vu = 0;
+                for (std::size_t i = 0; i < words; i++) {
+                    n_uv += popcount(ru[i] & ~rv[i]);
+                    n_vu += popcount(rv[i] & ~ru[i]);
+                }
+                double o_uv = n - 2 - n_uv - n_vu;
+                szeged += n_uv * n_vu;
+                revised_szeged += (n_uv + o_uv / 2) * (n_vu + o_uv / 2);
+            }
+        }
+    }
+    return make_pair(szeged, revised_szeged);
+}
+
+
+vector<double> DiameterTwo::betweenness(int threads, const Deadline& deadline) const {
+
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    vector<vector<double>> partial(threads);
+
+    parallel_ranges(n, threads, [&](int t, int begin, int end) {
+        auto& centrality = partial[t];
+        centrality.assign(n, 0.0);
+        vector<uint64_t> common(words);
+        for (int s = begin; s < end; s++) {
+            deadline.check();
+            const auto rs = row(s);
+            for (int u = s + 1; u < n; u++) {
+                if (rs[u / 64] & bit(u)) { continue; }
+                const auto ru = row(u);
+                int count = 0;
+                for (std::size_t i = 0; i < words; i++) {
+                    common[i] = rs[i] & ru[i];
+                    count += popcount(common[i]);
+                }
+                for (std::size_t word = 0; word < words; word++) {
+                    for (uint64_t b = common[word]; b; b &= b - 1) {
+                        centrality[word * 64 + __builtin_ctzll(b)] += 1.0 / count;
+                    }
+                }
+            }
+        }
+    });
+
+    vector<double> res(n, 0.0);
+    for (const auto& centrality : partial) {
+        for (std::size_t v = 0; v < centrality.size(); v++) { res[v] += centrality[v]; }
+    }
+    return res;
+}
+
+
+int girth(const Adjacency& adj, const Deadline& deadline) {
+
+    const int n = adj.vertices();
+    int best = numeric_limits<int>::max();
+    BreadthFirstSearch bfs(adj);
+    const auto& dist = bfs.distances();
+
+    for (int s = 0; s < n && best > 3; s++) {
+        deadline.check();
+        // Cycles closing at depth d have length at least 2d.
+        const int depth = bfs.run(s, (best == numeric_limits<int>::max()) ? best : best / 2);
+        for (int d = 1; d <= depth; d++) {
+            for (const int v : bfs.level(d)) {
+                int closer = 0;
+                uint32_t previous = n;
+                for (const auto u : adj.neighbours(v)) {
+                    if (u == previous) { continue; }
+                    previous = u;
+                    if (dist[u] == d - 1) {
+                        if (++closer == 2) { best = min(best, 2 * d); }
+                    } else if (dist[u] == d && (int) u < v) {
+                        best = min(best, 2 * d + 1);
+                    }
+                }
+            }
+        }
+    }
+
+    return (best == numeric_limits<int>::max()) ? 0 : best;
+}
+
+
+vector<double> betweenness(const Adjacency& adj, int threads, const Deadline& deadline) {
+
+    const int n = adj.vertices();
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    vector<vector<double>> partial(threads);
+
+    parallel_ranges(n, threads, [&](int t, int begin, int end) {
+        auto& centrality = partial[t];
+        centrality.assign(n, 0.0);
+        BreadthFirstSearch bfs(adj);
+        const auto& dist = bfs.distances();
+        vector<double> paths(n, 0.0), dependency(n, 0.0);
+        for (int s = begin; s < end; s++) {
+            deadline.check();
+            bfs.run(s);
+            const auto order = bfs.order();
+            paths[s] = 1.0;
+            for (std::ptrdiff_t i = 1; i < order.size(); i++) {
+                const int v = order[i];
+                double sum = 0.0;
+                for (const auto u : adj.neighbours(v)) {
+                    if (dist[u] == dist[v] - 1) { sum += paths[u]; }
+                }
+                paths[v] = sum;
+            }
+            for (std::ptrdiff_t i = order.size() - 1; i >= 0; i--) {
+                const int v = order[i];
+                double sum = 0.0;
+                for (const auto w : adj.neighbours(v)) {
+                    if (dist[w] == dist[v] + 1) { sum += (1.0 + dependency[w]) / paths[w]; }
+                }
+                dependency[v] = paths[v] * sum;
+                if (v != s) { centrality[v] += dependency[v]; }
+            }
+        }
+    });
+
+    // Every unordered pair was counted from both ends.
+    vector<double> res(n, 0.0);
+    for (const auto& centrality : partial) {
+        for (std::size_t v = 0; v < centrality.size(); v++) { res[v] += centrality[v] / 2; }
+    }
+    return res;
+}
+
+
+}
@@ -0,0 +1,279 @@
+
+#ifndef DISTANCE_HPP
+#define DISTANCE_HPP
+
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gsl/span"
+
+#include "adjacency.hpp"
+#include "compressed.hpp"
+#include "deadline.hpp"
+
+
+namespace graph {
+
+
+    // Direction-optimising breadth first search (Beamer, Asanovic & Patterson
+    // 2012). Each level is expanded top-down from the frontier queue while the
+    // frontier is small, and bottom-up once the edges leaving the frontier
+    // exceed 1/alpha of those incident to unvisited vertices: every unvisited
+    // vertex (taken from a bitset) scans its neighbours and stops at the first
+    // one in the frontier bitset. It returns to top-down when the frontier
+    // holds fewer than n/beta vertices. Buffers are kept between runs, so one
+    // search object is reused for many sources (one per thread).
+    //
+    // Reached vertices are recorded in order of level; the order within a
+    // level depends on the direction used for it. Instantiated for Adjacency
+    // (as BreadthFirstSearch) and CompressedAdjacency.
+
+    template<class Graph>
+    class BasicBreadthFirstSearch {
+
+        static constexpr int alpha = 14;
+        static constexpr int beta = 24;
+
+        const Graph& adj;
+        std::vector<int> dist;
+        std::vector<int> queue;
+        std::vector<int> level_start;
+        std::vector<uint64_t> frontier;
+        std::vector<uint64_t> unvisited;
+        std::size_t reached = 0;
+
+     public:
+
+        explicit BasicBreadthFirstSearch(const Graph&);
+
+        // Search from source, expanding at most max_depth levels. Returns the
+        // last level reached: the eccentricity of source within its connected
+        // component unless the search was cut off at max_depth.
+        int run(int source, int max_depth = std::numeric_limits<int>::max());
+
+        // Hop distances from the last source (-1 for vertices not reached).
+        const std::vector<int>& distances() const { return dist; }
+
+        // Reached vertices, source first, in nondecreasing distance.
+        gsl::span<const int> order() const { return gsl::span<const int>{queue.data(), (std::ptrdiff_t) reached}; }
+
+        // Vertices at distance d, for d up to the value returned by run.
+        gsl::span<const int> level(int d) const {
+            return gsl::span<const int>{queue.data() + level_start[d], level_start[d + 1] - level_start[d]};
+        }
+
+    };
+
+    extern template class BasicBreadthFirstSearch<Adjacency>;
+    extern template class BasicBreadthFirstSearch<CompressedAdjacency>;
+    using BreadthFirstSearch = BasicBreadthFirstSearch<Adjacency>;
+
+    // Per-vertex eccentricity bounds from the bounding diameters algorithm
+    // (Takes & Kosters 2011). BFS sources are chosen alternately as the vertex
+    // with the largest upper and the smallest lower bound, and every BFS
+    // tightens the bounds of all vertices in the source's component.
+    //
+    // If resolve_all is false, vertices that can no longer affect the diameter
+    // or radius are pruned and the search stops as soon as both are proven, so
+    // lower/upper may differ for some vertices. If resolve_all is true the search
+    // continues until lower == upper == eccentricity for every vertex.
+    //
+    // Eccentricities are taken within each connected component, matching
+    // igraph's handling of unconnected graphs.
+    struct EccentricityBounds {
+        int diameter = 0;
+        int radius = 0;
+        int bfs_runs = 0;
+        std::vector<int> lower;
+        std::vector<int> upper;
+    };
+
+    EccentricityBounds eccentricity_bounds(const Adjacency&, bool resolve_all);
+
+    // Sampled estimates of the average path length and Wiener index (sums over
+    // reachable pairs only). BFS sources are drawn without replacement from
+    // degree strata (equal sized groups of the degree ordering), one source per
+    // stratum per round, until the standard error of both estimates relative to
+    // their value is at most relative_error or every vertex has been a source
+    // (at which point the estimates are exact and standard errors are zero).
+    struct SampledEstimate {
+        double value = 0.0;
+        double standard_error = 0.0;
+    };
+
+    struct PathLengthEstimate {
+        SampledEstimate average_path_length;
+        SampledEstimate wiener_index;
+        int sources = 0;
+    };
+
+    PathLengthEstimate sample_path_lengths(const Adjacency&, double relative_error, unsigned seed);
+
+    // Streaming Wiener and Szeged indices: one BFS per source vertex, folded
+    // into the result immediately so no distance matrix is held. Sources are
+    // split over the given number of threads (0 = hardware concurrency), each
+    // holding one distance row and its own partial sums, so memory use is
+    // O((n + m) * threads). Unreachable pairs follow the igraph convention of
+    // infinite distance (the Wiener index of an unconnected graph is infinite).
+    double wiener_index_streaming(const Adjacency&, int threads);
+    std::pair<double, double> szeged_indices_streaming(const Adjacency&, int threads);
+
+    // Compact all-pairs hop distance matrix. Only the strict lower triangle is
+    // stored, row-major (row i holds d(i, 0 .. i-1) contiguously), using 8 bit
+    // entries unless the diameter needs 16. The largest value of the element
+    // type marks unreachable pairs. Typed row access is through the uint8_t or
+    // uint16_t instantiations of the template accessors, matching wide().
+
+    class DistanceMatrix {
+
+        int n = 0;
+        bool is_wide = false;
+        std::vector<uint8_t> narrow;
+        std::vector<uint16_t> wide_storage;
+
+        static std::size_t offset(int i) { return std::size_t(i) * (i - 1) / 2; }
+
+        template<class T>
+        const std::vector<T>& storage() const {
+            if constexpr (std::is_same_v<T, uint8_t>) { return narrow; } else { return wide_storage; }
+        }
+
+     public:
+
+        // All-pairs distances, split over threads (0 = hardware concurrency):
+        // bit-parallel layers where prefer_bit_parallel holds and the
+        // diameter is small, otherwise one BFS per source. Checks deadline
+        // per source (or block of 64).
+        explicit DistanceMatrix(const Adjacency&, int threads = 0, const Deadline& deadline = {});
+
+        int vertices() const { return n; }
+        bool wide() const { return is_wide; }
+
+        // Hop distance between i and j, or -1 if unreachable.
+        int element(int i, int j) const {
+            if (i == j) { return 0; }
+            if (i < j) { std::swap(i, j); }
+            int d = is_wide ? wide_storage[offset(i) + j] : narrow[offset(i) + j];
+            int unreachable = is_wide ? UINT16_MAX : UINT8_MAX;
+            return (d == unreachable) ? -1 : d;
+        }
+
+        // Entire triangle as one contiguous span.
+        template<class T>
+        gsl::span<const T> entries() const { return gsl::span<const T>{storage<T>().data(), (std::ptrdiff_t) storage<T>().size()}; }
+
+        // Distances from i to 0 .. i-1, contiguous.
+        template<class T>
+        gsl::span<const T> lower_row(int i) const { return gsl::span<const T>{storage<T>().data() + offset(i), i}; }
+
+        // Full row i gathered into out (the upper part is a strided column read).
+        template<class T>
+        void row(int i, std::vector<T>& out) const {
+            const auto& data = storage<T>();
+            out.resize(n);
+            std::copy(data.begin() + offset(i), data.begin() + offset(i) + i, out.begin());
+            out[i] = 0;
+            for (int j = i + 1; j < n; j++) { out[j] = data[offset(j) + i]; }
+        }
+
+    };
+
+    // Dense graphs (density at least 1/64) get their distance matrix from
+    // multi-source BFS over blocks of 64 sources (Then et al. 2014): bit s of
+    // a vertex's frontier word marks it as reached from source s, so each
+    // level is one bit-packed boolean product of the adjacency matrix with an
+    // n x 64 frontier matrix. A BFS per source touches 2m entries; a block
+    // level touches 2m words for 64 sources, so this wins while the
+    // diameter is below 64, by far for the small diameters of dense graphs.
+    bool prefer_bit_parallel(const Adjacency&);
+
+    double wiener_index(const DistanceMatrix&);
+
+    // Mean over reachable pairs (igraph's unconn = true), NaN if there are none.
+    double average_path_length(const DistanceMatrix&);
+
+    // Largest distance between reachable pairs (within components, as
+    // eccentricity_bounds), 0 if there are none.
+    int diameter(const DistanceMatrix&);
+
+    // Eccentricity of each vertex within its component (as eccentricity_bounds
+    // with resolve_all), whose maximum is the diameter.
+    std::vector<int> eccentricities(const DistanceMatrix&);
+
+    // Checks deadline per distance row.
+    std::pair<double, double> szeged_indices(const Adjacency&, const DistanceMatrix&, int threads,
+                                             const Deadline& deadline = {});
+
+    // Closed neighbourhood bitsets N[v] of a graph proven to have diameter at
+    // most 2, from which distance features follow by popcounts alone: pairs
+    // are at distance 1 if adjacent and 2 otherwise, a non-adjacent pair's
+    // shortest paths pass through its common neighbours, and the vertices
+    // strictly closer to u than v across an edge are u and N(u) \ N[v].
+    //
+    // prove() ORs the neighbourhood rows of each closed neighbourhood and
+    // succeeds if every result covers all vertices. It declines (cheaply,
+    // before allocating) unconnected graphs, graphs where some vertex cannot
+    // reach all others within 2 steps by degree counting alone, multigraphs
+    // (whose path counts the bitsets lose) and graphs over max_vertices.
+
+    class DiameterTwo {
+
+        int n = 0;
+        std::size_t words = 0;
+        std::vector<uint64_t> bits;
+
+        explicit DiameterTwo(const Adjacency&);
+
+        gsl::span<const uint64_t> row(int v) const {
+            return gsl::span<const uint64_t>{bits.data() + v * words, (std::ptrdiff_t) words};
+        }
+
+        int closed_degree(int v) const;
+
+     public:
+
+        static constexpr int max_vertices = 1 << 15;
+
+        static std::optional<DiameterTwo> prove(const Adjacency&);
+
+        int vertices() const { return n; }
+
+        // 1 for a vertex adjacent to all others, otherwise 2.
+        int eccentricity(int v) const { return (closed_degree(v) == n) ? 1 : 2; }
+
+        double wiener_index() const;
+
+        // These check deadline per vertex.
+        std::pair<double, double> szeged_indices(const Deadline& deadline = {}) const;
+
+        // Each non-adjacent pair adds 1 / |N(s) & N(t)| to its common
+        // neighbours; pairs are split over threads (0 = hardware concurrency).
+        std::vector<double> betweenness(int threads, const Deadline& deadline = {}) const;
+
+    };
+
+    // Girth: length of the shortest cycle, or 0 for a forest. Multiple edges
+    // do not form cycles (as in igraph). From each source, a vertex with two
+    // distinct neighbours one level closer closes an even cycle, and an edge
+    // within a level an odd one; searches are cut off at half the best cycle
+    // found so far. Checks deadline per source.
+    int girth(const Adjacency&, const Deadline& deadline = {});
+
+    // Vertex betweenness (Brandes 2001) over unordered pairs, with sources
+    // split over threads (0 = hardware concurrency). Each source's search
+    // only records levels; shortest path counts are then pulled from the
+    // previous level and dependencies from the next, one sweep each. Checks
+    // deadline per source.
+    std::vector<double> betweenness(const Adjacency&, int threads, const Deadline& deadline = {});
+
+
+}
+
+
+#endif
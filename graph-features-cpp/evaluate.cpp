@@ -1,50 +1,407 @@
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <sstream>
 
+#include "columnar.hpp"
+#include "featureset.hpp"
 #include "graph.hpp"
+#include "scheduler.hpp"
 
 using namespace std;
 using namespace graph;
 
 
-void print_features(const UndirectedGraph& g) {
-    cout << " 1. Vertices:              " << g.vertices() << endl;
-    cout << " 2. Edges:                 " << g.edges() << endl;
-    cout << " 3. Density:               " << density(g) << endl;
-    auto [ mean, stdev ] = simple_statistics(degree(g));
-    cout << " 4. Degree Mean:           " << mean << endl;
-    cout << " 5. Degree StDev:          " << stdev << endl;
-    cout << " 6. Average Path Length:   " << average_path_length(g) << endl;
-    cout << " 7. Diameter:              " << diameter(g) << endl;
-    cout << " 8. Girth:                 " << girth(g) << endl;
-    tie( mean, stdev ) = simple_statistics(betweenness_centrality(g));
-    cout << " 9. B Centrality Mean:     " << mean << endl;
-    cout << "10. B Centrality StDev:    " << stdev << endl;
-    cout << "11. Clustering Coeff:      " << clustering_coefficient(g) << endl;
-    auto [ szeged, revised_szeged ] = szeged_indices(g);
-    cout << "12. Szeged Index:          " << szeged << endl;
-    cout << "    Revised Szeged Index:  " << revised_szeged << endl;
-    auto [ energy, eig_stdev, beta ] = adjacency_eigenvalue_stats(g);
-    cout << "13. Beta:                  " << beta << endl;
-    cout << "14. Energy:                " << energy << endl;
-    cout << "15. Eigenvalue StDev:      " << eig_stdev << endl;
-    cout << "16. Alg. Connectivity:     " << algebraic_connectivity_lapack_dense(g) << endl;
-    tie( mean, stdev ) = simple_statistics(eigenvector_centrality(g));
-    cout << "17. E Centrality Mean:     " << mean << endl;
-    cout << "18. E Centrality StDev:    " << stdev << endl;
+using EvaluatedFeatures = FeatureSet<
+    Size, Density, DegreeStats, Cores, PathLength, Diameter, Girth, Betweenness, Clustering,
+    Szeged, Spectral, AlgebraicConnectivity, EigenvectorCentrality, WLHistograms>;
+
+
+// Prints the features. Missing features (under the limits they were
+// computed with) print as nan.
+void print_features(ostream& out, const EvaluatedFeatures::Result& f) {
+    const double nan = numeric_limits<double>::quiet_NaN();
+    auto value = [&](bool missing, double x) { return missing ? nan : x; };
+    auto moments = [&](bool missing, const Moments& m) {
+        if (!missing) { return m; }
+        Moments res;
+        res.mean = res.stdev = res.skewness = res.kurtosis = nan;
+        res.min = res.lower_quartile = res.median = res.upper_quartile = res.max = nan;
+        return res;
+    };
+    const bool cores = f.is_missing<Cores>();
+    const Moments betweenness = moments(f.is_missing<Betweenness>(), f.betweenness);
+    const bool szeged = f.is_missing<Szeged>();
+    const bool spectral = f.is_missing<Spectral>();
+    out << " 1. Vertices:              " << f.vertices << endl;
+    out << " 2. Edges:                 " << f.edges << endl;
+    out << " 3. Density:               " << f.density << endl;
+    out << " 4. Degree Mean:           " << f.degree.mean << endl;
+    out << " 5. Degree StDev:          " << f.degree.stdev << endl;
+    print_distribution(out, "Degree", f.degree);
+    out << "    Degeneracy:            " << value(cores, f.degeneracy) << endl;
+    out << "    Core Number Mean:      " << value(cores, f.core_number_mean) << endl;
+    out << "    Core Number StDev:     " << value(cores, f.core_number_stdev) << endl;
+    out << "    Smallest Last Colours: " << value(cores, f.smallest_last_colours) << endl;
+    out << " 6. Average Path Length:   " << value(f.is_missing<PathLength>(), f.average_path_length) << endl;
+    if (f.average_path_length_sampled) {
+        out << "    APL Approximate:       " << 1 << endl;
+    }
+    out << " 7. Diameter:              " << value(f.is_missing<Diameter>(), f.diameter) << endl;
+    out << " 8. Girth:                 " << value(f.is_missing<Girth>(), f.girth) << endl;
+    out << " 9. B Centrality Mean:     " << betweenness.mean << endl;
+    out << "10. B Centrality StDev:    " << betweenness.stdev << endl;
+    print_distribution(out, "B Centrality", betweenness);
+    out << "11. Clustering Coeff:      " << value(f.is_missing<Clustering>(), f.clustering_coefficient) << endl;
+    if (f.clustering_coefficient_sampled) {
+        out << "    CC Approximate:        " << 1 << endl;
+    }
+    out << "12. Szeged Index:          " << value(szeged, f.szeged_index) << endl;
+    out << "    Revised Szeged Index:  " << value(szeged, f.revised_szeged_index) << endl;
+    out << "13. Beta:                  " << value(spectral, f.beta) << endl;
+    out << "14. Energy:                " << value(spectral, f.energy) << endl;
+    out << "15. Eigenvalue StDev:      " << value(spectral, f.eigenvalue_stdev) << endl;
+    out << "16. Alg. Connectivity:     " << value(f.is_missing<AlgebraicConnectivity>(), f.algebraic_connectivity) << endl;
+    out << "17. E Centrality Mean:     " << f.eigenvector_centrality.mean << endl;
+    out << "18. E Centrality StDev:    " << f.eigenvector_centrality.stdev << endl;
+    print_distribution(out, "E Centrality", f.eigenvector_centrality);
+    const bool wl = f.is_missing<WLHistograms>();
+    for (int i = 0; i < WLHistograms::iterations; i++) {
+        for (int bin = 0; bin < WLHistograms::bins; bin++) {
+            out << "    WL Histogram " << i + 1 << "." << bin << ":      "
+                << (wl ? nan : f.wl_histograms[i][bin]) << endl;
+        }
+    }
+}
+
+
+// Per-vertex degree, betweenness, eigenvector centrality, eccentricity and
+// local clustering, as kept by the features; missing or approximated ones
+// are nan columns.
+vector<vector<double>> vertex_columns(const EvaluatedFeatures::Result& f, int vertices) {
+    vector<vector<double>> res;
+    auto add = [&](const vector<double>& v) {
+        res.push_back(v.empty() ? vector<double>(vertices, numeric_limits<double>::quiet_NaN()) : v);
+    };
+    add(f.vertex_degree);
+    add(f.vertex_betweenness);
+    add(f.vertex_eigenvector_centrality);
+    add(f.vertex_eccentricity);
+    add(f.vertex_clustering);
+    return res;
 }
 
 
+void print_quick_features(ostream& out, const QuickFeatures& f) {
+    out << " 1. Vertices:              " << f.vertices << endl;
+    out << " 2. Edges:                 " << f.edges << endl;
+    out << " 3. Density:               " << f.density << endl;
+    out << " 4. Degree Mean:           " << f.degree_mean << endl;
+    out << " 5. Degree StDev:          " << f.degree_stdev << endl;
+    out << "    Components:            " << f.components << endl;
+    out << "    Connected:             " << f.connected << endl;
+}
+
+
+void print_compressed_features(ostream& out, const CompressedFeatures& f) {
+    out << "    Clustering Coeff:      " << f.clustering_coefficient << endl;
+    out << "    Spectral Radius:       " << f.spectral_radius << endl;
+    out << "    Diameter Lower Bound:  " << f.diameter_lower_bound << endl;
+}
+
+
+// Longest predicted job first; by n (n + m) if the model cannot predict all
+// files yet. Unreadable files go last (and are reported when evaluated).
+void order_longest_first(vector<string>& instance_files, const CostModel& costs) {
+    vector<pair<double, double>> keys;
+    bool predicted = true;
+    for (const auto& instance_file : instance_files) {
+        double seconds = -1.0, proxy = -1.0;
+        try {
+            const auto [n, m] = read_dimacs_size(instance_file);
+            seconds = EvaluatedFeatures::predict_seconds(costs, n, m);
+            proxy = double(n) * (n + m);
+        } catch (...) {}
+        predicted = predicted && !isnan(seconds);
+        keys.emplace_back(seconds, proxy);
+    }
+    vector<int> order(instance_files.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return predicted ? keys[a].first > keys[b].first : keys[a].second > keys[b].second;
+    });
+    vector<string> ordered;
+    for (const int i : order) { ordered.push_back(instance_files[i]); }
+    instance_files = move(ordered);
+}
+
+
+// One instance file, evaluated as a job on the pool. Output is kept until
+// the evaluations of earlier files have been emitted, so it appears in input
+// order whatever the number of threads.
+struct Evaluation {
+    ostringstream text;
+    string notice;
+    string error;
+    vector<vector<double>> columns;
+    CostModel observed;
+    // For --skip-duplicates: the graph's WL fingerprint and canonical hash,
+    // and the earlier file it is identical to.
+    optional<pair<Hash128, Hash128>> keys;
+    optional<int> duplicate_of;
+    atomic<bool> done{false};
+};
+
+
 int main(int argc, char *argv[]) {
 
+    // --quick: single pass triage features, without building the graph.
+    // --compressed: with --quick, also read each graph into compressed
+    // adjacency (two further passes) for its transitivity, spectral radius
+    // and a diameter lower bound.
+    // --skip-duplicates: skip graphs identical to an earlier file (the same
+    // edges on the same vertex numbering), found by WL fingerprint and
+    // canonical edge hash and confirmed edge by edge.
+    // --simplify: read each graph as simple, removing duplicate edges ((a, b)
+    // and (b, a) alike) and self loops, and accepting an edge count that
+    // differs from the problem line; what was removed is reported.
+    // --vertex-features FILE: also write per-vertex feature columns to FILE,
+    // keyed by instance file stem (see columnar.hpp for the format).
+    // --threads N: worker threads (default 0, all cores), shared by the
+    // graphs evaluated concurrently and the features of each.
+    // --cost-model FILE: predict feature times from the model in FILE (fitted
+    // on this host), evaluate the slowest graphs first, and update FILE with
+    // the times observed.
+    // --budget SECONDS: with a cost model, features predicted to take longer
+    // use their approximate mode where they have one.
+    // --time-limit SECONDS, --memory-limit MB: exact features of a graph
+    // with a part still running SECONDS after it started, predicted (with a
+    // cost model) to take longer, or needing more than MB for shared data,
+    // fall back to their approximate mode, or else print as nan.
+    bool quick = false, compressed = false, skip_duplicates = false;
+    DimacsOptions dimacs_options;
+    string cost_file;
+    FeatureOptions options;
+    string vertex_file;
+    vector<string> instance_files;
     for (int i = 1; i < argc; i++) {
-        string instance_file(argv[i]);
+        string arg(argv[i]);
+        if (arg == "--quick") {
+            quick = true;
+        } else if (arg == "--compressed") {
+            compressed = true;
+        } else if (arg == "--skip-duplicates") {
+            skip_duplicates = true;
+        } else if (arg == "--simplify") {
+            dimacs_options.simplify = true;
+        } else if (arg == "--vertex-features" && i + 1 < argc) {
+            vertex_file = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (arg == "--cost-model" && i + 1 < argc) {
+            cost_file = argv[++i];
+        } else if (arg == "--budget" && i + 1 < argc) {
+            options.budget = atof(argv[++i]);
+        } else if (arg == "--time-limit" && i + 1 < argc) {
+            options.time_limit = atof(argv[++i]);
+        } else if (arg == "--memory-limit" && i + 1 < argc) {
+            options.memory_limit = atof(argv[++i]) * 1024 * 1024;
+        } else {
+            instance_files.push_back(arg);
+        }
+    }
+
+    unique_ptr<ColumnarWriter> vertex_writer;
+    if (!vertex_file.empty() && !quick) {
+        try {
+            vertex_writer = make_unique<ColumnarWriter>(vertex_file, vector<string>{
+                "degree", "betweenness", "eigenvector_centrality", "eccentricity", "clustering"});
+        } catch (...) {
+            cerr << "Could not open " << vertex_file << endl;
+            return 1;
+        }
+    }
+
+    unique_ptr<CostModel> costs;
+    if (!cost_file.empty() && !quick) {
+        try {
+            costs = make_unique<CostModel>(cost_file);
+        } catch (...) {
+            cerr << "Could not read " << cost_file << endl;
+            return 1;
+        }
+        options.costs = costs.get();
+        order_longest_first(instance_files, *costs);
+    }
+
+    ThreadPool pool(options.threads);
+    dimacs_options.threads = options.threads;
+    const int files = instance_files.size();
+    vector<unique_ptr<Evaluation>> evaluations(files);
+
+    // Files whose features were started, by WL fingerprint and canonical
+    // hash: candidates for later files to duplicate, confirmed edge by edge
+    // (as dedup --identical). A file found identical to a candidate as it is
+    // read skips its features; one read before its candidate was found is
+    // matched when emitted, so output does not depend on timing. Only a
+    // candidate evaluated successfully (settled when emitted) stands in for
+    // its duplicates; otherwise they are evaluated after all.
+    mutex seen_lock;
+    map<pair<Hash128, Hash128>, vector<int>> candidates;
+    vector<char> evaluated(files, false);
+    auto identical = [&](int j, const UndirectedGraph& g) {
         try {
-            const UndirectedGraph g = read_dimacs(instance_file);
+            const UndirectedGraph other = read_dimacs(instance_files[j], dimacs_options);
+            return other.vertices() == g.vertices() && canonical_edges(other) == canonical_edges(g);
+        } catch (...) {
+            return false;
+        }
+    };
+
+    auto evaluate = [&](int i, bool skip_duplicate) {
+        Evaluation& e = *evaluations[i];
+        const string& instance_file = instance_files[i];
+        try {
+            if (quick) {
+                print_quick_features(e.text, read_dimacs_quick(instance_file));
+                if (compressed) {
+                    print_compressed_features(e.text, compressed_features(read_dimacs_compressed(instance_file)));
+                }
+            } else {
+                DimacsReport report;
+                const UndirectedGraph g = read_dimacs(instance_file, dimacs_options, &report);
+                if (report.duplicate_edges || report.self_loops || report.edge_lines != report.declared_edges) {
+                    e.notice = "Simplified " + instance_file + ": " + to_string(report.edge_lines) + " edge lines ("
+                        + to_string(report.declared_edges) + " declared), removed " + to_string(report.duplicate_edges)
+                        + " duplicate edges and " + to_string(report.self_loops) + " self loops";
+                }
+                // One refinement pass gives the fingerprint and the histograms.
+                optional<WLSketch> sketch;
+                if (skip_duplicate) {
+                    sketch = wl_sketch(g.adjacency(), WLHistograms::iterations, WLHistograms::bins, options.threads);
+                    e.keys.emplace(sketch->fingerprint, canonical_hash(g));
+                    vector<int> earlier;
+                    {
+                        lock_guard<mutex> guard(seen_lock);
+                        earlier = candidates[*e.keys];
+                    }
+                    sort(earlier.begin(), earlier.end());
+                    for (const int j : earlier) {
+                        if (j < i && identical(j, g)) {
+                            e.duplicate_of = j;
+                            break;
+                        }
+                    }
+                    if (!e.duplicate_of) {
+                        lock_guard<mutex> guard(seen_lock);
+                        candidates[*e.keys].push_back(i);
+                    }
+                }
+                if (!e.duplicate_of) {
+                    FeatureOptions instance_options = options;
+                    instance_options.observe = costs ? &e.observed : nullptr;
+                    instance_options.wl_sketch = sketch ? &*sketch : nullptr;
+                    const auto f = EvaluatedFeatures::compute(g, instance_options);
+                    print_features(e.text, f);
+                    if (vertex_writer) { e.columns = vertex_columns(f, g.vertices()); }
+                }
+            }
+        } catch (...) {
+            e.error = "Skipped " + instance_file + " due to error";
+        }
+        e.done = true;
+    };
+
+    // Keeps a few files per thread in flight, so the pool stays busy while
+    // finished output waits for a slow earlier file.
+    const int window = 2 * pool.size();
+    int started = 0;
+    for (int i = 0; i < files; i++) {
+        for (; started < files && started < i + window; started++) {
+            evaluations[started] = make_unique<Evaluation>();
+            pool.spawn([&evaluate, started, skip_duplicates]() { evaluate(started, skip_duplicates); });
+        }
+        pool.help_until([&]() { return evaluations[i]->done.load(); });
+        const string& instance_file = instance_files[i];
+        if (evaluations[i]->keys && !evaluations[i]->duplicate_of) {
+            vector<int> earlier;
+            {
+                lock_guard<mutex> guard(seen_lock);
+                earlier = candidates[*evaluations[i]->keys];
+            }
+            earlier.erase(remove_if(earlier.begin(), earlier.end(), [&](int j) { return j >= i || !evaluated[j]; }),
+                          earlier.end());
+            sort(earlier.begin(), earlier.end());
+            if (!earlier.empty()) {
+                try {
+                    const UndirectedGraph g = read_dimacs(instance_file, dimacs_options);
+                    for (const int j : earlier) {
+                        if (identical(j, g)) {
+                            evaluations[i]->duplicate_of = j;
+                            break;
+                        }
+                    }
+                } catch (...) {}
+            }
+        }
+        if (const auto first = evaluations[i]->duplicate_of) {
+            if (evaluated[*first]) {
+                if (!evaluations[i]->notice.empty()) {
+                    cerr << evaluations[i]->notice << endl;
+                }
+                cerr << "Skipped " << instance_file << " as duplicate of " << instance_files[*first] << endl;
+                evaluations[i].reset();
+                continue;
+            }
+            // The file it duplicates failed, so evaluate this one after all.
+            evaluations[i] = make_unique<Evaluation>();
+            pool.spawn([&evaluate, i]() { evaluate(i, false); });
+            pool.help_until([&]() { return evaluations[i]->done.load(); });
+        }
+        Evaluation& e = *evaluations[i];
+
+        if (!e.notice.empty()) {
+            cerr << e.notice << endl;
+        }
+        if (!e.error.empty()) {
+            cerr << e.error << endl;
+        }
+        if (e.error.empty() && vertex_writer) {
+            // Written first, so a file is in both outputs or neither.
+            try {
+                vector<gsl::span<const double>> columns;
+                for (const auto& c : e.columns) { columns.emplace_back(c.data(), c.size()); }
+                vertex_writer->write(filesystem::path(instance_file).stem().string(), columns);
+            } catch (...) {
+                e.error = "Skipped " + instance_file + " due to error writing " + vertex_file;
+                cerr << e.error << endl;
+            }
+        }
+        if (e.error.empty()) {
             cout << "===== " << instance_file << " =====" << endl;
-            print_features(g);
+            cout << e.text.str();
+            if (costs) { costs->add(e.observed); }
+            evaluated[i] = true;
+        }
+        evaluations[i].reset();
+    }
+
+    if (costs) {
+        try {
+            costs->save(cost_file);
         } catch (...) {
-            cerr << "Skipped " << instance_file << " due to error" << endl;
+            cerr << "Could not write " << cost_file << endl;
         }
     }
 
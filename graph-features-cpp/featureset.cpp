@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "gsl/gsl_assert"
+#include "featureset.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+const char* context::name(unsigned context) {
+    switch (context) {
+        case adjacency: return "context:adjacency";
+        case diameter_two: return "context:diameter_two";
+        case distances: return "context:distances";
+        case components: return "context:components";
+        case spectrum: return "context:spectrum";
+        case triangles: return "context:triangles";
+        default: throw "Unknown feature context.";
+    }
+}
+
+
+double context::bytes(unsigned context, int vertices, double) {
+    const double n = vertices;
+    switch (context) {
+        case adjacency: return 0;  // held by the graph
+        case diameter_two: return (n <= DiameterTwo::max_vertices) ? n * ceil(n / 64) * 8 : 0;
+        case distances: return n * (n - 1) / 2;
+        case components: return n / 8 + 4 * n;
+        case spectrum: return 8 * n * n + 8 * n;
+        case triangles: return 8 * n;
+        default: throw "Unknown feature context.";
+    }
+}
+
+
+void FeatureContext::build(unsigned context) {
+    switch (context) {
+        case context::adjacency:
+            adjacency = &graph.adjacency();
+            break;
+        case context::diameter_two:
+            diameter_two = graph.diameter_two();
+            break;
+        case context::distances:
+            if (!diameter_two) { distances.emplace(*adjacency, threads, Deadline(time_limit)); }
+            break;
+        case context::components: {
+            // Depth first search from each unvisited vertex.
+            const int n = adjacency->vertices();
+            vector<bool> visited(n, false);
+            vector<int> stack;
+            components = 0;
+            for (int s = 0; s < n; s++) {
+                if (visited[s]) { continue; }
+                (*components)++;
+                visited[s] = true;
+                stack.push_back(s);
+                while (!stack.empty()) {
+                    const int u = stack.back();
+                    stack.pop_back();
+                    for (const auto v : adjacency->neighbours(u)) {
+                        if (!visited[v]) {
+                            visited[v] = true;
+                            stack.push_back(v);
+                        }
+                    }
+                }
+            }
+            break;
+        }
+        case context::spectrum: {
+            lock_guard<mutex> guard(igraph_mutex());
+            const igraphVector eigenvalues = adjacency_eigenvalues(graph);
+            spectrum.emplace(eigenvalues.begin(), eigenvalues.end());
+            break;
+        }
+        case context::triangles:
+            triangles.emplace(vertex_triangles(*adjacency));
+            break;
+        default:
+            throw "Unknown feature context.";
+    }
+}
+
+
+void Size::compute(const FeatureContext& context) {
+    vertices = context.graph.vertices();
+    edges = context.graph.edges();
+}
+
+
+void Density::compute(const FeatureContext& context) {
+    density = graph::density(context.graph);
+}
+
+
+void DegreeStats::compute(const FeatureContext& context) {
+    const igraphVector degrees = graph::degree(context.graph);
+    vertex_degree.assign(degrees.begin(), degrees.end());
+    degree = moment_statistics(vertex_degree);
+}
+
+
+void Cores::compute(const FeatureContext& context) {
+    const Adjacency& adjacency = *context.adjacency;
+    const auto cores = core_decomposition(adjacency);
+    degeneracy = cores.degeneracy;
+    tie(core_number_mean, core_number_stdev) = simple_statistics(cores.core_number);
+    const auto colours = greedy_colouring(adjacency, cores.ordering);
+    smallest_last_colours = colours.empty() ? 0 : *max_element(colours.begin(), colours.end()) + 1;
+}
+
+
+void PathLength::compute(const FeatureContext& context) {
+    if (const auto& two = context.diameter_two) {
+        const double n = two->vertices();
+        average_path_length = two->wiener_index() / (n * (n - 1) / 2);
+    } else {
+        average_path_length = graph::average_path_length(*context.distances);
+    }
+}
+
+
+void PathLength::approximate(const FeatureContext& context) {
+    average_path_length = sample_path_lengths(*context.adjacency, 0.01, 0).average_path_length.value;
+    average_path_length_sampled = true;
+}
+
+
+void Diameter::compute(const FeatureContext& context) {
+    if (const auto& two = context.diameter_two) {
+        diameter = 1;
+        vertex_eccentricity.resize(two->vertices());
+        for (int v = 0; v < two->vertices(); v++) {
+            vertex_eccentricity[v] = two->eccentricity(v);
+            diameter = max(diameter, two->eccentricity(v));
+        }
+    } else {
+        const auto eccentricities = graph::eccentricities(*context.distances);
+        vertex_eccentricity.assign(eccentricities.begin(), eccentricities.end());
+        diameter = eccentricities.empty() ? 0 : *max_element(eccentricities.begin(), eccentricities.end());
+    }
+}
+
+
+void Girth::compute(const FeatureContext& context) {
+    girth = graph::girth(*context.adjacency, Deadline(context.time_limit));
+}
+
+
+void Betweenness::compute(const FeatureContext& context) {
+    const auto& two = context.diameter_two;
+    const Deadline deadline(context.time_limit);
+    vertex_betweenness = two ?
+        two->betweenness(context.threads, deadline) :
+        graph::betweenness(*context.adjacency, context.threads, deadline);
+    betweenness = moment_statistics(vertex_betweenness);
+}
+
+
+void Clustering::compute(const FeatureContext& context) {
+    // Zero without connected triples, as IGRAPH_TRANSITIVITY_ZERO.
+    // Local coefficients are zero below degree 2.
+    const Adjacency& adjacency = *context.adjacency;
+    double triangles = 0.0, triples = 0.0;
+    vertex_clustering.resize(adjacency.vertices());
+    for (int v = 0; v < adjacency.vertices(); v++) {
+        double d = adjacency.degree(v);
+        triangles += (*context.triangles)[v];
+        triples += d * (d - 1) / 2;
+        vertex_clustering[v] = (d < 2) ? 0.0 : (*context.triangles)[v] / (d * (d - 1) / 2);
+    }
+    clustering_coefficient = (triples > 0) ? triangles / triples : 0.0;
+}
+
+
+void Clustering::approximate(const FeatureContext& context) {
+    clustering_coefficient = sample_transitivity(*context.adjacency, 10000, 0).value;
+    clustering_coefficient_sampled = true;
+}
+
+
+void Szeged::compute(const FeatureContext& context) {
+    const Deadline deadline(context.time_limit);
+    if (const auto& two = context.diameter_two) {
+        tie(szeged_index, revised_szeged_index) = two->szeged_indices(deadline);
+    } else {
+        tie(szeged_index, revised_szeged_index) = szeged_indices(
+            *context.adjacency, *context.distances, context.threads, deadline);
+    }
+}
+
+
+void Spectral::compute(const FeatureContext& context) {
+    tie(energy, eigenvalue_stdev, beta) = adjacency_eigenvalue_stats(*context.spectrum);
+}
+
+
+void AlgebraicConnectivity::compute(const FeatureContext& context) {
+    lock_guard<mutex> guard(igraph_mutex());
+    algebraic_connectivity = graph::algebraic_connectivity(context.graph, *context.components == 1);
+}
+
+
+void EigenvectorCentrality::compute(const FeatureContext& context) {
+    const igraphVector centrality = graph::eigenvector_centrality(context.graph);
+    vertex_eigenvector_centrality.assign(centrality.begin(), centrality.end());
+    eigenvector_centrality = moment_statistics(vertex_eigenvector_centrality);
+}
+
+
+void WLHistograms::compute(const FeatureContext& context) {
+    const auto sketch = context.wl_sketch ? *context.wl_sketch :
+        wl_sketch(*context.adjacency, iterations, bins, context.threads);
+    const int n = context.adjacency->vertices();
+    wl_histograms.clear();
+    for (const auto& counts : sketch.histograms) {
+        wl_histograms.emplace_back(counts.begin(), counts.end());
+        for (auto& fraction : wl_histograms.back()) { fraction /= max(1, n); }
+    }
+}
+
+
+namespace impl {
+
+    vector<string> run_features(FeatureContext& context, const vector<ScheduledFeature>& features,
+                                const FeatureOptions& options) {
+
+        const int n = context.graph.vertices();
+        const double m = context.graph.edges();
+
+        // Mode of each feature, and the contexts needed for those. Under the
+        // memory limit, contexts go to the features that need them first.
+        // The time limit applies to each part on its own (NaN if any part is
+        // unknown, as predict_seconds).
+        auto longest_part = [&](const ScheduledFeature& feature) {
+            double res = predict_seconds(*options.costs, 0, {feature.name}, n, m);
+            const unsigned contexts = context::closure(feature.needs);
+            for (int c = 0; c < context::count; c++) {
+                if (!(contexts & (1u << c))) { continue; }
+                const double part = predict_seconds(*options.costs, 1u << c, {}, n, m);
+                if (isnan(part) || part > res) { res = part; }
+            }
+            return res;
+        };
+        enum Mode { exact, approximate, missing };
+        vector<Mode> mode(features.size(), exact);
+        unsigned needs = 0;
+        for (std::size_t i = 0; i < features.size(); i++) {
+            const auto& feature = features[i];
+            if (feature.needs != 0) {
+                const double predicted = options.costs ?
+                    predict_seconds(*options.costs, context::closure(feature.needs), {feature.name}, n, m) :
+                    numeric_limits<double>::quiet_NaN();
+                const bool slow = (options.costs && longest_part(feature) > options.time_limit) ||
+                                  (feature.approximate && predicted > options.budget);
+                const bool large = predict_bytes(context::closure(needs | feature.needs), n, m) > options.memory_limit;
+                if (slow || large) {
+                    const bool fits = predict_bytes(context::closure(needs | feature.approximate_needs), n, m) <=
+                                      options.memory_limit;
+                    mode[i] = (feature.approximate && fits) ? approximate : missing;
+                }
+            }
+            needs |= (mode[i] == exact) ? feature.needs : (mode[i] == approximate) ? feature.approximate_needs : 0;
+        }
+        needs = context::closure(needs);
+
+        // Exact work checks a fresh deadline as it starts (so a limit of zero
+        // cancels it all), and cancellable kernels theirs while they run; what
+        // is cancelled leaves its context unbuilt, and a feature without all
+        // its contexts is cancelled too.
+        TaskGraph tasks;
+        int built_task[context::count];
+        atomic<unsigned> built{0};
+        double context_seconds[context::count];
+        vector<double> feature_seconds(features.size());
+        vector<char> cancelled(features.size(), false);
+        auto after = [&](unsigned uses) {
+            vector<int> ids;
+            for (int c = 0; c < context::count; c++) {
+                if (uses & (1u << c)) { ids.push_back(built_task[c]); }
+            }
+            return ids;
+        };
+        auto seconds_since = [](chrono::steady_clock::time_point start) {
+            return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        };
+        for (int c = 0; c < context::count; c++) {
+            const unsigned bit = 1u << c;
+            if (!(needs & bit)) { continue; }
+            built_task[c] = tasks.add([&, bit, c]() {
+                if (context::uses(bit) & ~built.load()) { return; }
+                try {
+                    const auto start = chrono::steady_clock::now();
+                    if (bit != context::adjacency) { Deadline(context.time_limit).check(); }
+                    context.build(bit);
+                    context_seconds[c] = seconds_since(start);
+                    built |= bit;
+                } catch (const Cancelled&) {}
+            }, after(context::uses(bit)));
+        }
+        for (std::size_t i = 0; i < features.size(); i++) {
+            const auto& feature = features[i];
+            if (mode[i] == approximate) {
+                tasks.add([&]() { feature.approximate(context); }, after(feature.approximate_needs));
+            } else if (mode[i] == exact) {
+                tasks.add([&, i]() {
+                    if (context::closure(feature.needs) & ~built.load()) {
+                        cancelled[i] = true;
+                        return;
+                    }
+                    try {
+                        const auto start = chrono::steady_clock::now();
+                        if (feature.needs != 0) { Deadline(context.time_limit).check(); }
+                        feature.compute(context);
+                        feature_seconds[i] = seconds_since(start);
+                    } catch (const Cancelled&) {
+                        cancelled[i] = true;
+                    }
+                }, after(feature.needs));
+            }
+        }
+        tasks.run(options.threads);
+
+        // Cancelled features fall back to their approximate mode where its
+        // contexts were built.
+        TaskGraph fallbacks;
+        for (std::size_t i = 0; i < features.size(); i++) {
+            if (!cancelled[i]) { continue; }
+            const auto& feature = features[i];
+            feature.reset();
+            if (feature.approximate && !(context::closure(feature.approximate_needs) & ~built.load())) {
+                mode[i] = approximate;
+                fallbacks.add([&]() { feature.approximate(context); });
+            } else {
+                mode[i] = missing;
+            }
+        }
+        fallbacks.run(options.threads);
+
+        if (options.observe) {
+            for (int c = 0; c < context::count; c++) {
+                const unsigned bit = 1u << c;
+                // The distance matrix is skipped where diameter two holds.
+                if ((built & bit) && !(bit == context::distances && !context.distances)) {
+                    options.observe->observe(context::name(bit), n, m, context_seconds[c]);
+                }
+            }
+            for (std::size_t i = 0; i < features.size(); i++) {
+                if (mode[i] == exact) { options.observe->observe(features[i].name, n, m, feature_seconds[i]); }
+            }
+        }
+
+        vector<string> res;
+        for (std::size_t i = 0; i < features.size(); i++) {
+            if (mode[i] == missing) { res.push_back(features[i].name); }
+        }
+        return res;
+
+    }
+
+    double predict_seconds(const CostModel& costs, unsigned contexts, initializer_list<const char*> features,
+                           int vertices, double edges) {
+        double res = 0.0;
+        for (int c = 0; c < context::count; c++) {
+            if (contexts & (1u << c)) { res += costs.predict(context::name(1u << c), vertices, edges); }
+        }
+        for (const char* feature : features) { res += costs.predict(feature, vertices, edges); }
+        return res;
+    }
+
+    double predict_bytes(unsigned contexts, int vertices, double edges) {
+        double res = 0.0;
+        for (int c = 0; c < context::count; c++) {
+            if (contexts & (1u << c)) { res += context::bytes(1u << c, vertices, edges); }
+        }
+        return res;
+    }
+
+}
+
+
+}
@@ -0,0 +1,352 @@
+#ifndef FEATURESET_HPP
+#define FEATURESET_HPP
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "costmodel.hpp"
+#include "deadline.hpp"
+#include "graph.hpp"
+#include "scheduler.hpp"
+
+
+namespace graph {
+
+    // Compile-time feature selection for callers that need only a few
+    // features. FeatureSet<Fs...> computes exactly the features Fs, first
+    // building each shared intermediate result (context) that at least one of
+    // them needs, once. The result type derives from every Fs, so values are
+    // typed members:
+    //
+    //     using Triage = FeatureSet<Density, DegreeStats, Cores>;
+    //     const auto f = Triage::compute(g);
+    //     f.density; f.degree.mean; f.degeneracy;
+    //
+    // Contexts and features are scheduled as a TaskGraph, each starting once
+    // the contexts it reads are built, so independent ones run concurrently.
+    // Those that still call igraph (the dense spectrum and dense algebraic
+    // connectivity) hold igraph_mutex, so they run one at a time across all
+    // graphs.
+
+    namespace context {
+
+        enum : unsigned {
+            adjacency = 1,      // CSR adjacency (the graph's own)
+            diameter_two = 2,   // DiameterTwo proof, where it holds
+            distances = 4,      // distance matrix, where diameter_two does not hold
+            components = 8,     // number of connected components
+            spectrum = 16,      // all adjacency eigenvalues (dense)
+            triangles = 32,     // triangles through each vertex
+        };
+
+        constexpr int count = 6;
+
+        // Contexts each one is built from (always lower bits).
+        constexpr unsigned uses(unsigned context) {
+            switch (context) {
+                case distances: return diameter_two | adjacency;
+                case diameter_two: case components: case triangles: return adjacency;
+                default: return 0;
+            }
+        }
+
+        constexpr unsigned closure(unsigned needs) {
+            for (int c = count - 1; c >= 0; c--) {
+                if (needs & (1u << c)) { needs |= uses(1u << c); }
+            }
+            return needs;
+        }
+
+        // Name for cost model observations.
+        const char* name(unsigned context);
+
+        // Approximate memory held by a context of a graph with the given size
+        // (contexts dominate the memory of computing features).
+        double bytes(unsigned context, int vertices, double edges);
+
+    }
+
+    // Contexts of one graph, empty until built. Kernels within contexts and
+    // features split over threads (0 = hardware concurrency), and those that
+    // can be cancelled check a Deadline of time_limit seconds taken as their
+    // context or feature starts, so time spent queued for a thread is not
+    // counted.
+    struct FeatureContext {
+        const UndirectedGraph& graph;
+        const int threads;
+        const double time_limit;
+        const Adjacency* adjacency = nullptr;
+        const DiameterTwo* diameter_two = nullptr;
+        std::optional<DistanceMatrix> distances;
+        std::optional<int> components;
+        std::optional<std::vector<double>> spectrum;
+        std::optional<std::vector<uint64_t>> triangles;
+        // Given if the caller already refined the graph (FeatureOptions).
+        const WLSketch* wl_sketch = nullptr;
+
+        FeatureContext(const UndirectedGraph& graph, int threads,
+                       double time_limit = std::numeric_limits<double>::infinity())
+            : graph(graph), threads(threads), time_limit(time_limit) {}
+
+        // Builds one context, after those it uses.
+        void build(unsigned context);
+    };
+
+    // Features. Each has a name (for the cost model), declares the contexts
+    // it reads, and fills its members from them; values match the functions
+    // of the same name in graph.hpp. Features with an approximate mode also
+    // declare the contexts that reads. Features summarising a per-vertex
+    // vector keep it (vertex_ members, empty when approximated or missing).
+
+    struct Size {
+        static constexpr const char* name = "size";
+        static constexpr unsigned needs = 0;
+        int vertices = 0;
+        int edges = 0;
+        void compute(const FeatureContext&);
+    };
+
+    struct Density {
+        static constexpr const char* name = "density";
+        static constexpr unsigned needs = 0;
+        double density = 0.0;
+        void compute(const FeatureContext&);
+    };
+
+    struct DegreeStats {
+        static constexpr const char* name = "degree_stats";
+        static constexpr unsigned needs = 0;
+        Moments degree;
+        std::vector<double> vertex_degree;
+        void compute(const FeatureContext&);
+    };
+
+    struct Cores {
+        static constexpr const char* name = "cores";
+        static constexpr unsigned needs = context::adjacency;
+        int degeneracy = 0;
+        double core_number_mean = 0.0;
+        double core_number_stdev = 0.0;
+        int smallest_last_colours = 0;
+        void compute(const FeatureContext&);
+    };
+
+    // Approximately, by sampled BFS sources to 1% relative standard error.
+    struct PathLength {
+        static constexpr const char* name = "path_length";
+        static constexpr unsigned needs = context::distances;
+        static constexpr unsigned approximate_needs = context::adjacency;
+        double average_path_length = 0.0;
+        bool average_path_length_sampled = false;
+        void compute(const FeatureContext&);
+        void approximate(const FeatureContext&);
+    };
+
+    struct Diameter {
+        static constexpr const char* name = "diameter";
+        static constexpr unsigned needs = context::distances;
+        int diameter = 0;
+        std::vector<double> vertex_eccentricity;
+        void compute(const FeatureContext&);
+    };
+
+    struct Girth {
+        static constexpr const char* name = "girth";
+        static constexpr unsigned needs = context::adjacency;
+        int girth = 0;
+        void compute(const FeatureContext&);
+    };
+
+    struct Betweenness {
+        static constexpr const char* name = "betweenness";
+        static constexpr unsigned needs = context::diameter_two;
+        Moments betweenness;
+        std::vector<double> vertex_betweenness;
+        void compute(const FeatureContext&);
+    };
+
+    // Global transitivity from the triangle counts (as clustering_coefficient
+    // on simple graphs), or approximately from 10000 sampled wedges.
+    struct Clustering {
+        static constexpr const char* name = "clustering";
+        static constexpr unsigned needs = context::triangles;
+        static constexpr unsigned approximate_needs = context::adjacency;
+        double clustering_coefficient = 0.0;
+        bool clustering_coefficient_sampled = false;
+        std::vector<double> vertex_clustering;
+        void compute(const FeatureContext&);
+        void approximate(const FeatureContext&);
+    };
+
+    struct Szeged {
+        static constexpr const char* name = "szeged";
+        static constexpr unsigned needs = context::distances;
+        double szeged_index = 0.0;
+        double revised_szeged_index = 0.0;
+        void compute(const FeatureContext&);
+    };
+
+    struct Spectral {
+        static constexpr const char* name = "spectral";
+        static constexpr unsigned needs = context::spectrum;
+        double energy = 0.0;
+        double eigenvalue_stdev = 0.0;
+        double beta = 0.0;
+        void compute(const FeatureContext&);
+    };
+
+    struct AlgebraicConnectivity {
+        static constexpr const char* name = "algebraic_connectivity";
+        static constexpr unsigned needs = context::components;
+        double algebraic_connectivity = 0.0;
+        void compute(const FeatureContext&);
+    };
+
+    struct EigenvectorCentrality {
+        static constexpr const char* name = "eigenvector_centrality";
+        static constexpr unsigned needs = context::adjacency;
+        Moments eigenvector_centrality;
+        std::vector<double> vertex_eigenvector_centrality;
+        void compute(const FeatureContext&);
+    };
+
+    // Fractions of vertices in each of 8 hashed label bins after WL
+    // refinements 1 .. 3 (as wl_histograms).
+    struct WLHistograms {
+        static constexpr const char* name = "wl_histograms";
+        static constexpr unsigned needs = context::adjacency;
+        static constexpr int iterations = 3;
+        static constexpr int bins = 8;
+        std::vector<std::vector<double>> wl_histograms;
+        void compute(const FeatureContext&);
+    };
+
+    struct FeatureOptions {
+        // Workers for the task graph, and threads for kernels within tasks
+        // (0 = hardware concurrency).
+        int threads = 0;
+        // Features with an approximate mode use it if costs predicts that
+        // they (with the contexts they need) take longer than budget seconds.
+        const CostModel* costs = nullptr;
+        double budget = std::numeric_limits<double>::infinity();
+        // If given, records the time of each context built and each feature
+        // computed exactly.
+        CostModel* observe = nullptr;
+        // Each part of the exact work (a context or a feature) still running
+        // time_limit seconds after it started is cancelled, and work with a
+        // part that costs predicts to take longer, or whose contexts need
+        // more than memory_limit bytes, is not started. Features affected use
+        // their approximate mode where they have one, and are otherwise
+        // missing. Features that need no context are always computed. Only
+        // kernels that check a Deadline are cancelled: the dense spectrum
+        // and eigenvector centrality are bounded only by the prediction, so
+        // only with costs.
+        double time_limit = std::numeric_limits<double>::infinity();
+        double memory_limit = std::numeric_limits<double>::infinity();
+        // The graph's wl_sketch of WLHistograms::iterations refinements into
+        // WLHistograms::bins bins, if the caller took it already (say for its
+        // fingerprint), so the histograms reuse that refinement pass.
+        const WLSketch* wl_sketch = nullptr;
+    };
+
+    namespace impl {
+
+        template<class Feature, class = void>
+        struct has_approximation : std::false_type {};
+
+        template<class Feature>
+        struct has_approximation<Feature, std::void_t<decltype(Feature::approximate_needs)>> : std::true_type {};
+
+        // A feature of a set, type erased for scheduling.
+        struct ScheduledFeature {
+            const char* name = nullptr;
+            unsigned needs = 0;
+            std::function<void(const FeatureContext&)> compute;
+            unsigned approximate_needs = 0;
+            std::function<void(const FeatureContext&)> approximate;
+            std::function<void()> reset;
+        };
+
+        template<class Feature>
+        ScheduledFeature scheduled(Feature& feature) {
+            ScheduledFeature res;
+            res.name = Feature::name;
+            res.needs = Feature::needs;
+            res.compute = [&feature](const FeatureContext& c) { feature.compute(c); };
+            res.reset = [&feature]() { feature = Feature(); };
+            if constexpr (has_approximation<Feature>::value) {
+                res.approximate_needs = Feature::approximate_needs;
+                res.approximate = [&feature](const FeatureContext& c) { feature.approximate(c); };
+            }
+            return res;
+        }
+
+        // Returns the names of the features left missing.
+        std::vector<std::string> run_features(FeatureContext&, const std::vector<ScheduledFeature>&,
+                                              const FeatureOptions&);
+
+        // Sum of predictions for the named features (exact) and contexts, NaN
+        // if any is unknown.
+        double predict_seconds(const CostModel&, unsigned contexts, std::initializer_list<const char*> features,
+                               int vertices, double edges);
+
+        // Sum of context::bytes over contexts.
+        double predict_bytes(unsigned contexts, int vertices, double edges);
+
+    }
+
+    template<class... Features>
+    struct FeatureSet {
+
+        static constexpr unsigned needs = context::closure((Features::needs | ... | 0u));
+
+        struct Result : Features... {
+            // Features abandoned under the limits of FeatureOptions, left
+            // with their default values.
+            std::vector<std::string> missing;
+
+            template<class Feature>
+            bool is_missing() const {
+                for (const auto& name : missing) {
+                    if (name == Feature::name) { return true; }
+                }
+                return false;
+            }
+        };
+
+        static Result compute(const UndirectedGraph& graph, const FeatureOptions& options) {
+            FeatureContext context(graph, options.threads, options.time_limit);
+            context.wl_sketch = options.wl_sketch;
+            Result res;
+            res.missing = impl::run_features(context, {impl::scheduled<Features>(res)...}, options);
+            return res;
+        }
+
+        static Result compute(const UndirectedGraph& graph, int threads = 0) {
+            FeatureOptions options;
+            options.threads = threads;
+            return compute(graph, options);
+        }
+
+        // Exact computation time predicted by costs (NaN until all parts have
+        // been observed), and bytes of the contexts needed.
+        static double predict_seconds(const CostModel& costs, int vertices, double edges) {
+            return impl::predict_seconds(costs, needs, {Features::name...}, vertices, edges);
+        }
+
+        static double predict_bytes(int vertices, double edges) {
+            return impl::predict_bytes(needs, vertices, edges);
+        }
+
+    };
+
+}
+
+
+#endif
@@ -1,9 +1,17 @@
 
+#include <algorithm>
+#include <cctype>
 #include <cmath>
+#include <cstdlib>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
 
 #include "gsl/gsl_assert"
+#include "builder.hpp"
 #include "graph.hpp"
+#include "hash.hpp"
 
 
 using namespace std;
@@ -12,16 +20,87 @@ using namespace std;
 namespace graph {
 
 
+const shared_ptr<const impl::GraphData>& impl::empty_graph_data() {
+    static const shared_ptr<const GraphData> body = make_shared<const GraphData>();
+    return body;
+}
+
+
+UndirectedGraph::UndirectedGraph(impl::igraph_ptr& g) {
+    const int m = igraph_ecount(g.get());
+    igraphVector edge_list(m * 2);
+    igraph_get_edgelist(g.get(), edge_list.get(), false);
+    edge_list.update();
+
+    vector<pair<int, int>> pairs;
+    vector<uint32_t> self_loops;
+    pairs.reserve(m);
+    for (int e = 0; e < m; e++) {
+        const int a = edge_list[e * 2], b = edge_list[e * 2 + 1];
+        if (a == b) { self_loops.push_back(a); }
+        pairs.emplace_back(a, b);
+    }
+    auto body = make_shared<impl::GraphData>(Adjacency(igraph_vcount(g.get()), pairs), move(self_loops));
+
+    // The igraph form is already at hand.
+    body->lazy.graph = move(g);
+    call_once(body->lazy.converted, []() {});
+    data = move(body);
+}
+
+
+const DiameterTwo* UndirectedGraph::diameter_two() const {
+    impl::LazyDiameterTwo& lazy = data->diameter_two;
+    call_once(lazy.proved, [this, &lazy]() { lazy.two = DiameterTwo::prove(adjacency()); });
+    return lazy.two ? &*lazy.two : nullptr;
+}
+
+
 void UndirectedGraph::add_edges(vector<pair<int, int>> edges)
 {
-    igraphVector v(edges.size() * 2);
-    int i = 0;
-    for (auto edge : edges) {
-        VECTOR(*v.get())[i] = edge.first;
-        VECTOR(*v.get())[i+1] = edge.second;
-        i += 2;
+    // Rebuild from the new edges and the existing ones (each once, u < v).
+    const int n = vertices();
+    GraphBuilder builder(n);
+    builder.add_edges(move(edges));
+    builder.reserve(builder.size() + this->edges());
+    for (int u = 0; u < n; u++) {
+        for (const auto v : data->core.neighbours(u)) {
+            if ((int) v > u) { builder.add_edge(u, v); }
+        }
     }
-    igraph_add_edges(graph.get(), v.get(), 0);
+    for (const auto v : data->self_loops) { builder.add_edge(v, v); }
+    data = builder.build().data;
+}
+
+
+const igraph_t* UndirectedGraph::get() const
+{
+    impl::LazyIgraph& lazy = data->lazy;
+    call_once(lazy.converted, [this, &lazy]() {
+        // Each edge once (u < v, with multiplicity), then the self loops.
+        igraphVector edge_list(edges() * 2);
+        int i = 0;
+        for (int u = 0; u < vertices(); u++) {
+            for (const auto v : data->core.neighbours(u)) {
+                if ((int) v <= u) { continue; }
+                VECTOR(*edge_list.get())[i++] = u;
+                VECTOR(*edge_list.get())[i++] = v;
+            }
+        }
+        for (const auto v : data->self_loops) {
+            VECTOR(*edge_list.get())[i++] = v;
+            VECTOR(*edge_list.get())[i++] = v;
+        }
+        lazy.graph = impl::create_igraph_ptr();
+        igraph_create(lazy.graph.get(), edge_list.get(), vertices(), IGRAPH_UNDIRECTED);
+    });
+    return lazy.graph.get();
+}
+
+
+mutex& igraph_mutex() {
+    static mutex lock;
+    return lock;
 }
 
 
@@ -40,27 +119,99 @@ bool is_connected(const UndirectedGraph& graph) {
 
 
 const igraphVector degree(const UndirectedGraph& graph) {
+    // Self loops are not counted (as IGRAPH_NO_LOOPS).
+    const Adjacency& adjacency = graph.adjacency();
     igraphVector res(graph.vertices());
-    /*int ret = */igraph_degree(graph.get(), res.get(), igraph_vss_all(), IGRAPH_ALL, IGRAPH_NO_LOOPS);
-    res.update();
+    for (int v = 0; v < graph.vertices(); v++) {
+        VECTOR(*res.get())[v] = adjacency.degree(v);
+    }
     Ensures(res.size() == graph.vertices());
     return res;
 }
 
+const igraphVector core_number(const UndirectedGraph& graph) {
+    igraphVector res(graph.vertices());
+    const auto cores = core_decomposition(graph.adjacency());
+    for (int v = 0; v < graph.vertices(); v++) {
+        VECTOR(*res.get())[v] = cores.core_number[v];
+    }
+    Ensures(res.size() == graph.vertices());
+    return res;
+}
+
+int degeneracy(const UndirectedGraph& graph) {
+    return core_decomposition(graph.adjacency()).degeneracy;
+}
+
+const vector<int> smallest_last_ordering(const UndirectedGraph& graph) {
+    return core_decomposition(graph.adjacency()).ordering;
+}
+
+int smallest_last_colours(const UndirectedGraph& graph) {
+    const Adjacency& adjacency = graph.adjacency();
+    const auto cores = core_decomposition(adjacency);
+    const auto colours = greedy_colouring(adjacency, cores.ordering);
+    Ensures(graph.vertices() == 0 || *max_element(colours.begin(), colours.end()) <= cores.degeneracy);
+    return (graph.vertices() == 0) ? 0 : *max_element(colours.begin(), colours.end()) + 1;
+}
+
+const Hash128 wl_fingerprint(const UndirectedGraph& graph, int iterations, int threads) {
+    return wl_fingerprint(graph.adjacency(), iterations, threads);
+}
+
+const vector<pair<int, int>> canonical_edges(const UndirectedGraph& graph) {
+    vector<uint32_t> loops = graph.self_loops();
+    sort(loops.begin(), loops.end());
+    vector<pair<int, int>> res;
+    res.reserve(graph.edges());
+    auto loop = loops.begin();
+    for (int u = 0; u < graph.vertices(); u++) {
+        for (; loop != loops.end() && (int) *loop == u; ++loop) { res.emplace_back(u, u); }
+        for (const auto v : graph.adjacency().neighbours(u)) {
+            if ((int) v > u) { res.emplace_back(u, v); }
+        }
+    }
+    return res;
+}
+
+const Hash128 canonical_hash(const UndirectedGraph& graph) {
+    Hash128 res{splitmix64(graph.vertices()), splitmix64(~uint64_t(graph.vertices()))};
+    for (const auto& [a, b] : canonical_edges(graph)) {
+        const uint64_t edge = (uint64_t(a) << 32) | uint32_t(b);
+        res.high = splitmix64(res.high ^ edge);
+        res.low = splitmix64(res.low + edge);
+    }
+    return res;
+}
+
+const vector<vector<double>> wl_histograms(const UndirectedGraph& graph, int iterations, int width, int threads) {
+    const auto sketch = wl_sketch(graph.adjacency(), iterations, width, threads);
+    vector<vector<double>> res;
+    for (const auto& counts : sketch.histograms) {
+        res.emplace_back(counts.begin(), counts.end());
+        for (auto& fraction : res.back()) { fraction /= max(1, graph.vertices()); }
+    }
+    return res;
+}
+
 const igraphVector betweenness_centrality(const UndirectedGraph& graph) {
     igraphVector res(graph.vertices());
-    /*int ret = */igraph_betweenness(
-        graph.get(), res.get(),
-        igraph_vss_all(),
-        false,          // false = undirected
-        nullptr,        // NULL = unweighted
-        true);          // nobigint = true
-    res.update();
+    const Adjacency& adjacency = graph.adjacency();
+    const auto two = graph.diameter_two();
+    const auto centrality = two ? two->betweenness(0) : betweenness(adjacency, 0);
+    for (int v = 0; v < graph.vertices(); v++) {
+        VECTOR(*res.get())[v] = centrality[v];
+    }
     Ensures(res.size() == graph.vertices());
     return res;
 }
 
 const igraphVector eigenvector_centrality(const UndirectedGraph& graph) {
+    return eigenvector_centrality_lanczos(graph);
+}
+
+
+const igraphVector eigenvector_centrality_arpack(const UndirectedGraph& graph) {
     igraphVector res(graph.vertices());
     igraph_arpack_options_t options;
     igraph_arpack_options_init(&options);
@@ -77,6 +228,36 @@ const igraphVector eigenvector_centrality(const UndirectedGraph& graph) {
 }
 
 
+const igraphVector eigenvector_centrality_lanczos(const UndirectedGraph& graph) {
+    igraphVector res(graph.vertices());
+    if (graph.vertices() == 0) { return res; }
+    // Every vertex is equally central in a regular graph (including one
+    // without edges), as igraph has it; exactly, not to Lanczos rounding.
+    const Adjacency& adjacency = graph.adjacency();
+    bool regular = true;
+    for (int v = 1; regular && v < graph.vertices(); v++) { regular = adjacency.degree(v) == adjacency.degree(0); }
+    if (regular) {
+        for (int v = 0; v < graph.vertices(); v++) { VECTOR(*res.get())[v] = 1.0; }
+        return res;
+    }
+
+    // Principal eigenvector, signed positive and scaled to a maximum of one.
+    // Its entries are non-negative (Perron-Frobenius), so rounding below zero
+    // (off the leading component) is clamped.
+    auto top = lanczos_adjacency(adjacency, 1, SpectrumEnd::largest);
+    Ensures(top.vectors.size() == 1);
+    const auto& x = top.vectors[0];
+    double largest = 0.0;
+    for (const double xi : x) {
+        if (fabs(xi) > fabs(largest)) { largest = xi; }
+    }
+    for (int v = 0; v < graph.vertices(); v++) {
+        VECTOR(*res.get())[v] = (largest != 0.0) ? max(0.0, x[v] / largest) : 0.0;
+    }
+    return res;
+}
+
+
 const igraphVector adjacency_eigenvalues(const UndirectedGraph& graph) {
     // Get adjacency matrix.
     igraphMatrix adjacency(graph.vertices(), graph.vertices());
@@ -109,17 +290,18 @@ const tuple<double, double, double> adjacency_eigenvalue_stats(const UndirectedG
     //      (absolute) eigenvalue standard deviation
     //      beta bipartitivity parameter (even closed walks/all closed walks)
 
-    // Calculate eigenvalues and absolutes.
+    // Calculate eigenvalues.
     const igraphVector eigenvalues = adjacency_eigenvalues(graph);
-    vector<double> absolute_eigenvalues;
-    absolute_eigenvalues.reserve(graph.vertices());
-    for (const auto & v : eigenvalues) {
-        absolute_eigenvalues.push_back(fabs(v));
-    }
-    Ensures(absolute_eigenvalues.size() == (uint) graph.vertices());
+    Ensures(eigenvalues.size() == graph.vertices());
+    return adjacency_eigenvalue_stats(vector<double>(eigenvalues.begin(), eigenvalues.end()));
+}
+
+
+const tuple<double, double, double> adjacency_eigenvalue_stats(const vector<double>& eigenvalues) {
 
-    // Mean/stdev statistics.
-    auto [energy, stdev] = simple_statistics(absolute_eigenvalues);
+    // Mean/stdev statistics of absolute values.
+    const Moments absolute = moment_statistics(eigenvalues, [](double v) { return fabs(v); });
+    const double energy = absolute.mean, stdev = absolute.stdev;
 
     // Beta bipartitivity.
     double sc_even = 0.0;
@@ -133,38 +315,99 @@ const tuple<double, double, double> adjacency_eigenvalue_stats(const UndirectedG
 }
 
 
+namespace {
+
+    // Second smallest Laplacian eigenvalue by dense LAPACK, or by sparse
+    // Lanczos orthogonal to the constant vector (0 for fewer than two
+    // vertices, which have no second eigenvalue).
+
+    double laplacian_second_smallest_dense(const UndirectedGraph& graph) {
+
+        if (graph.vertices() <= 1) { return 0; }
+
+        // Get laplacian matrix.
+        igraphMatrix laplacian(graph.vertices(), graph.vertices());
+        /*int ret = */igraph_laplacian(
+            graph.get(), laplacian.get(),
+            nullptr,                    // don't create sparse laplacian
+            false,                      // false = non-normalised
+            nullptr);                   // null = unweighted
+
+        // Must allocate N-length workspace to avoid memory issues. igraph will resize.
+        //      ref https://github.com/igraph/igraph/issues/1109
+        igraphVector result(graph.vertices());
+        /*int ret = */igraph_lapack_dsyevr(
+            laplacian.get(),
+            IGRAPH_LAPACK_DSYEV_SELECT,
+            0.0, 0.0, 0.0,      // bounds for eigenvalues (only for INTERVAL)
+            2, 2,               // select second smallest eigenvalue only
+            1e-10,              // convergence tolerance
+            result.get(),       // resulting eigenvalues
+            nullptr,            // eigenvectors are discarded
+            nullptr);           // support is discarded
+        result.update();
+
+        // Resulting vector has size 1, so begin() points to the result.
+        Ensures(result.size() == 1);
+        return *result.begin();
+    }
+
+    double laplacian_second_smallest_sparse(const UndirectedGraph& graph) {
+        if (graph.vertices() <= 1) { return 0; }
+        auto res = lanczos_laplacian(graph.adjacency(), 1, SpectrumEnd::smallest, true);
+        Ensures(res.values.size() == 1);
+        return res.values[0];
+    }
+
+}
+
+
 double algebraic_connectivity_lapack_dense(const UndirectedGraph& graph) {
     
     // Short-circuit.
     if (!is_connected(graph)) { return 0; }
+    return laplacian_second_smallest_dense(graph);
+}
 
-    // Get laplacian matrix.
-    igraphMatrix laplacian(graph.vertices(), graph.vertices());
-    /*int ret = */igraph_laplacian(
-        graph.get(), laplacian.get(),
-        nullptr,                    // don't create sparse laplacian
-        false,                      // false = non-normalised
-        nullptr);                   // null = unweighted
+double algebraic_connectivity_lanczos_sparse(const UndirectedGraph& graph) {
+
+    // Short-circuit.
+    if (!is_connected(graph)) { return 0; }
+    return laplacian_second_smallest_sparse(graph);
+}
 
-    // Must allocate N-length workspace to avoid memory issues. igraph will resize.
-    //      ref https://github.com/igraph/igraph/issues/1109
-    igraphVector result(graph.vertices());
-    /*int ret = */igraph_lapack_dsyevr(
-        laplacian.get(),
-		IGRAPH_LAPACK_DSYEV_SELECT,
-		0.0, 0.0, 0.0,      // bounds for eigenvalues (only for INTERVAL)
-		2, 2,               // select second smallest eigenvalue only
-        1e-10,              // convergence tolerance
-		result.get(),       // resulting eigenvalues
-        nullptr,            // eigenvectors are discarded
-		nullptr);           // support is discarded
-    result.update();
 
-    // Resulting vector has size 1, so begin() points to the result.
-    Ensures(result.size() == 1);
-    return *result.begin();
+double algebraic_connectivity(const UndirectedGraph& graph) {
+    return algebraic_connectivity(graph, is_connected(graph));
 }
 
+
+double algebraic_connectivity(const UndirectedGraph& graph, bool connected) {
+    if (!connected) { return 0; }
+    // Dense LAPACK is exact and fast enough below this size.
+    const int dense_limit = 500;
+    if (graph.vertices() <= dense_limit) {
+        return laplacian_second_smallest_dense(graph);
+    }
+    return laplacian_second_smallest_sparse(graph);
+}
+
+
+double spectral_radius(const UndirectedGraph& graph) {
+    if (graph.vertices() == 0) { return 0; }
+    auto res = lanczos_adjacency(graph.adjacency(), 1, SpectrumEnd::both);
+    return max(fabs(res.values.front()), fabs(res.values.back()));
+}
+
+
+double smallest_adjacency_eigenvalue(const UndirectedGraph& graph) {
+    if (graph.vertices() == 0) { return 0; }
+    auto res = lanczos_adjacency(graph.adjacency(), 1, SpectrumEnd::smallest);
+    Ensures(res.values.size() == 1);
+    return res.values[0];
+}
+
+
 int multiplier(igraph_real_t *to, const igraph_real_t *from, int n, void *extra) {
 
     const igraph_matrix_t* A = (igraph_matrix_t*) extra;
@@ -224,65 +467,45 @@ double algebraic_connectivity_arpack_dense(const UndirectedGraph& graph) {
 
 double wiener_index(const UndirectedGraph& graph) {
     // Simple sum of inter-vertex distances over unordered vertex pairs.
-    igraphMatrix res(graph.vertices(), graph.vertices());
-    igraph_shortest_paths(graph.get(), res.get(), igraph_vss_all(), igraph_vss_all(), IGRAPH_ALL);
+    const Adjacency& adjacency = graph.adjacency();
+    if (const auto two = graph.diameter_two()) { return two->wiener_index(); }
+    return wiener_index(DistanceMatrix(adjacency));
+}
 
-    double result = 0;
-    for (int i = 0; i < graph.vertices(); i++) {
-        for (int j = i + 1; j < graph.vertices(); j++) {
-            result += res.element(i, j);
-        }
-    }
 
-    return result;
+const pair<double, double> wiener_index_sampled(const UndirectedGraph& graph, double relative_error, unsigned seed) {
+    auto res = sample_path_lengths(graph.adjacency(), relative_error, seed);
+    return make_pair(res.wiener_index.value, res.wiener_index.standard_error);
 }
 
 
 const pair<double, double> szeged_indices(const UndirectedGraph& graph) {
+    const Adjacency& adjacency = graph.adjacency();
+    if (const auto two = graph.diameter_two()) { return two->szeged_indices(); }
+    return szeged_indices(adjacency, DistanceMatrix(adjacency), 0);
+}
 
-    // Edge list.
-    igraphVector edge_list(graph.edges() * 2);
-    igraph_get_edgelist(graph.get(), edge_list.get(), false);
-    edge_list.update();
-
-    // Distance matrix.
-    igraphMatrix distance(graph.vertices(), graph.vertices());
-    igraph_shortest_paths(graph.get(), distance.get(), igraph_vss_all(), igraph_vss_all(), IGRAPH_ALL);
-
-    double szeged = 0, revised_szeged = 0;
-
-    for (int e = 0; e < graph.edges(); e++) {
-
-        int u = edge_list[e * 2];
-        int v = edge_list[e * 2 + 1];
-        double n_uv = 0, n_vu = 0, o_uv = 0;
 
-        // Compare distances from all other vertices to u and v.
-        for (int i = 0; i < graph.vertices(); i++) {
-            if ((i == u) || (i == v)) { continue; }
+const pair<double, double> szeged_indices(const UndirectedGraph& graph, const DistanceMatrix& distance) {
+    return szeged_indices(graph.adjacency(), distance, 0);
+}
 
-            if (distance.element(u, i) < distance.element(v, i)) {
-                // vertex i is closer to u than v
-                n_uv += 1;
-            } else if (distance.element(u, i) > distance.element(v, i)) {
-                // vertex i is closer to v than u
-                n_vu += 1;
-            } else {
-                // i is equidistant from v and u
-                o_uv += 1;
-            }
-        }
 
-        szeged += n_uv * n_vu;
-        revised_szeged += (n_uv + o_uv / 2) * (n_vu + o_uv / 2);
+double wiener_index_streaming(const UndirectedGraph& graph, int threads) {
+    return wiener_index_streaming(graph.adjacency(), threads);
+}
 
-    }
 
-    return make_pair(szeged, revised_szeged);
+const pair<double, double> szeged_indices_streaming(const UndirectedGraph& graph, int threads) {
+    return szeged_indices_streaming(graph.adjacency(), threads);
 }
 
 
 double average_path_length(const UndirectedGraph& graph) {
+    const int n = graph.vertices();
+    const Adjacency& adjacency = graph.adjacency();
+    if (const auto two = graph.diameter_two()) { return two->wiener_index() / (double(n) * (n - 1) / 2); }
+    if (prefer_bit_parallel(adjacency)) { return average_path_length(DistanceMatrix(adjacency)); }
     igraph_real_t res;
     /*int ret = */igraph_average_path_length(
         graph.get(), &res,
@@ -291,31 +514,66 @@ double average_path_length(const UndirectedGraph& graph) {
     return res;
 }
 
+const pair<double, double> average_path_length_sampled(const UndirectedGraph& graph, double relative_error, unsigned seed) {
+    auto res = sample_path_lengths(graph.adjacency(), relative_error, seed);
+    return make_pair(res.average_path_length.value, res.average_path_length.standard_error);
+}
+
 int diameter(const UndirectedGraph& graph) {
-    igraph_integer_t res;
-    /*int ret = */igraph_diameter(
-        graph.get(), &res,
-        nullptr,        // igraph_integer_t *pfrom
-        nullptr,        // igraph_integer_t *pto
-        nullptr,        // igraph_vector_t *path
-        false,          // igraph_bool_t directed (ignored)
-        true);          // igraph_bool_t unconn
-    return res;
+    // Bounding diameters search stops once diameter and radius are proven.
+    const Adjacency& adjacency = graph.adjacency();
+    if (const auto two = graph.diameter_two()) {
+        for (int v = 0; v < two->vertices(); v++) {
+            if (two->eccentricity(v) == 2) { return 2; }
+        }
+        return 1;
+    }
+    return eccentricity_bounds(adjacency, false).diameter;
 }
 
 int radius(const UndirectedGraph& graph) {
-    igraph_real_t res;
-    /*int ret = */igraph_radius(
-        graph.get(), &res,
-        IGRAPH_ALL);    // igraph_neimode_t mode
+    const Adjacency& adjacency = graph.adjacency();
+    if (const auto two = graph.diameter_two()) {
+        for (int v = 0; v < two->vertices(); v++) {
+            if (two->eccentricity(v) == 1) { return 1; }
+        }
+        return 2;
+    }
+    return eccentricity_bounds(adjacency, false).radius;
+}
+
+const igraphVector eccentricity(const UndirectedGraph& graph) {
+    const Adjacency& adjacency = graph.adjacency();
+    igraphVector res(graph.vertices());
+    if (const auto two = graph.diameter_two()) {
+        for (int v = 0; v < graph.vertices(); v++) {
+            VECTOR(*res.get())[v] = two->eccentricity(v);
+        }
+        return res;
+    }
+    // Continue the bounding search until every vertex is resolved.
+    const auto bounds = eccentricity_bounds(adjacency, true);
+    for (int v = 0; v < graph.vertices(); v++) {
+        VECTOR(*res.get())[v] = bounds.lower[v];
+    }
+    Ensures(res.size() == graph.vertices());
     return res;
 }
 
 int girth(const UndirectedGraph& graph) {
-    igraph_integer_t res;
-    /*int ret = */igraph_girth(
-        graph.get(), &res,
-        nullptr);       // igraph_vector_t *circle
+    return girth(graph.adjacency());
+}
+
+const igraphVector local_clustering_coefficient(const UndirectedGraph& graph) {
+    // Zero for vertices of degree below 2, as IGRAPH_TRANSITIVITY_ZERO.
+    const Adjacency& adjacency = graph.adjacency();
+    const auto triangles = vertex_triangles(adjacency);
+    igraphVector res(graph.vertices());
+    for (int v = 0; v < graph.vertices(); v++) {
+        double d = adjacency.degree(v);
+        VECTOR(*res.get())[v] = (d < 2) ? 0.0 : triangles[v] / (d * (d - 1) / 2);
+    }
+    Ensures(res.size() == graph.vertices());
     return res;
 }
 
@@ -328,42 +586,282 @@ double clustering_coefficient(const UndirectedGraph& graph) {
 }
 
 
+namespace {
+
+    // Integer field at pos on the current line (strtol alone would skip to
+    // the next), advancing past it; throws error if there is none.
+    long read_field(const char*& pos, const char* error) {
+        while (*pos == ' ' || *pos == '\t') { pos++; }
+        char* next;
+        const long value = strtol(pos, &next, 10);
+        if (next == pos || isspace(*pos)) {
+            throw error;
+        }
+        pos = next;
+        return value;
+    }
+
+    // Single pass over a DIMACS col file, calling on_header(vertices, edges)
+    // for the 'p' line and on_edge(a, b) (zero based) for each 'e' line.
+    // The file is read in large blocks of whole lines, each parsed in place,
+    // so memory does not grow with the file. Returns the number of edge
+    // lines.
+    template<class OnHeader, class OnEdge>
+    uint scan_dimacs(const string& file_name, OnHeader on_header, OnEdge on_edge) {
+
+        ifstream col_file(file_name, ios::binary);
+        if (!col_file.is_open()) {
+            throw "File not open.";
+        }
+
+        uint edge_lines = 0;
+        auto parse = [&](const char* pos) {
+            while (*pos) {
+                if (*pos == 'p') {
+                    // p <format> <vertices> <edges>
+                    pos++;
+                    while (*pos == ' ' || *pos == '\t') { pos++; }
+                    while (*pos && !isspace(*pos)) { pos++; }
+                    const long vertices = read_field(pos, "Malformed problem line.");
+                    const long edges = read_field(pos, "Malformed problem line.");
+                    if (vertices < 0 || edges < 0) {
+                        throw "Malformed problem line.";
+                    }
+                    on_header(vertices, edges);
+                } else if (*pos == 'e') {
+                    pos++;
+                    const long a = read_field(pos, "Malformed edge line.");
+                    const long b = read_field(pos, "Malformed edge line.");
+                    on_edge(a - 1, b - 1);
+                    edge_lines++;
+                }
+                // Skip the remainder of the line.
+                while (*pos && *pos != '\n') { pos++; }
+                if (*pos) { pos++; }
+            }
+        };
+
+        // Each block is parsed up to its last line break; the partial line
+        // after it moves to the front of the next block.
+        const std::size_t block = 1 << 22;
+        string buffer;
+        std::size_t carried = 0;
+        while (true) {
+            buffer.resize(carried + block + 1);
+            col_file.read(&buffer[carried], block);
+            const std::size_t end = carried + col_file.gcount();
+            const bool last = !col_file;
+            std::size_t lines_end = end;
+            if (!last) {
+                while (lines_end > 0 && buffer[lines_end - 1] != '\n') { lines_end--; }
+            }
+            const char kept = buffer[lines_end];
+            buffer[lines_end] = '\0';
+            parse(buffer.c_str());
+            if (last) { break; }
+            buffer[lines_end] = kept;
+            buffer.erase(0, lines_end);
+            carried = end - lines_end;
+        }
+
+        return edge_lines;
+    }
+
+}
+
+
+const pair<double, double> clustering_coefficient_sampled(const UndirectedGraph& graph, int samples, unsigned seed) {
+    auto res = sample_transitivity(graph.adjacency(), samples, seed);
+    return make_pair(res.value, res.variance);
+}
+
+
 UndirectedGraph read_dimacs(string file_name) {
+    return read_dimacs(file_name, DimacsOptions());
+}
 
-    uint vertices = 0, edges = 0;
-    vector<pair<int, int>> edge_list;
 
-    string line;
+UndirectedGraph read_dimacs(string file_name, const DimacsOptions& options, DimacsReport* report) {
+
+    uint edges = 0;
+    unique_ptr<GraphBuilder> builder;
+
+    scan_dimacs(file_name,
+        [&](uint n, uint m) {
+            edges = m;
+            builder = make_unique<GraphBuilder>(n, options.threads);
+            builder->reserve(edges);
+        },
+        [&](int a, int b) {
+            if (!builder) { throw "Edge before problem line."; }
+            builder->add_edge(a, b);
+        });
+
+    if (!builder) { throw "Missing problem line."; }
+    DimacsReport counts;
+    counts.declared_edges = edges;
+    counts.edge_lines = builder->size();
+    if (options.simplify) {
+        counts.duplicate_edges = builder->deduplicate();
+        counts.self_loops = builder->drop_self_loops();
+    } else if (builder->size() != edges) {
+        throw "Incorrect number of edges.";
+    }
+    if (report) { *report = counts; }
+
+    return builder->build();
+
+}
+
+
+const pair<int, int> read_dimacs_size(string file_name) {
     ifstream col_file(file_name);
-    if (col_file.is_open()) {
-        while ( getline(col_file, line) ) {
-            if (line.substr(0, 1).compare("p") == 0) {
-                // assert vertices, edges are 0
-                string info = line.substr(7, line.size());
-                auto found = info.find(" ");
-                vertices = stoi(info.substr(0, found));
-                edges = stoi(info.substr(found + 1, info.size()));
-                edge_list.reserve(edges);
-            } else if (line.substr(0, 1).compare("e") == 0) {
-                // assert vertices, edges are not 0
-                string info = line.substr(2, line.size());
-                auto found = info.find(" ");
-                int a = stoi(info.substr(0, found));
-                int b = stoi(info.substr(found + 1, info.size()));
-                edge_list.emplace_back(a - 1, b - 1);
+    if (!col_file.is_open()) {
+        throw "File not open.";
+    }
+    string line;
+    while (getline(col_file, line)) {
+        if (!line.empty() && line[0] == 'p') {
+            istringstream fields(line.substr(1));
+            string format;
+            int vertices = 0, edges = 0;
+            fields >> format >> vertices >> edges;
+            if (!fields) {
+                throw "Malformed problem line.";
             }
+            return make_pair(vertices, edges);
         }
-    } else {
-        throw "File not open.";
     }
+    throw "Missing problem line.";
+}
+
+
+QuickFeatures read_dimacs_quick(string file_name) {
+
+    // Degree counts and a union-find forest (path halving, union by size).
+    vector<int> degrees, parent, size;
+    uint edges = 0, components = 0;
+
+    auto find = [&](int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    };
+
+    uint edge_lines = scan_dimacs(file_name,
+        [&](uint n, uint m) {
+            edges = m;
+            components = n;
+            degrees.assign(n, 0);
+            size.assign(n, 1);
+            parent.resize(n);
+            for (uint v = 0; v < n; v++) { parent[v] = v; }
+        },
+        [&](int a, int b) {
+            if ((a < 0) || (b < 0) || ((uint) a >= degrees.size()) || ((uint) b >= degrees.size())) {
+                throw "Vertex out of range.";
+            }
+            // Self loops count as edges but not towards degree (as igraph_degree).
+            if (a == b) { return; }
+            degrees[a]++;
+            degrees[b]++;
+            int ra = find(a), rb = find(b);
+            if (ra == rb) { return; }
+            if (size[ra] < size[rb]) { swap(ra, rb); }
+            parent[rb] = ra;
+            size[ra] += size[rb];
+            components--;
+        });
+
+    if (edge_lines != edges) {
+        throw "Incorrect number of edges.";
+    }
+
+    QuickFeatures res;
+    res.vertices = degrees.size();
+    res.edges = edges;
+    double v = res.vertices;
+    res.density = 2 * res.edges / (v * (v - 1));
+    tie(res.degree_mean, res.degree_stdev) = simple_statistics(degrees);
+    res.components = components;
+    res.connected = (components == 1);
+    return res;
+
+}
 
-    if (edge_list.size() != edges) {
+
+CompressedAdjacency read_dimacs_compressed(string file_name) {
+
+    // Degrees from a first pass; later passes gather each block of
+    // neighbour lists from the file again instead of holding the edges.
+    uint edges = 0;
+    vector<std::size_t> degrees;
+    uint edge_lines = scan_dimacs(file_name,
+        [&](uint n, uint m) {
+            edges = m;
+            degrees.assign(n, 0);
+        },
+        [&](int a, int b) {
+            if ((a < 0) || (b < 0) || ((uint) a >= degrees.size()) || ((uint) b >= degrees.size())) {
+                throw "Vertex out of range.";
+            }
+            if (a == b) { return; }
+            degrees[a]++;
+            degrees[b]++;
+        });
+
+    if (edge_lines != edges) {
         throw "Incorrect number of edges.";
     }
 
-    UndirectedGraph g(vertices);
-    g.add_edges(edge_list);
-    return g;
+    return CompressedAdjacency::from_edges(degrees, [&](auto add) {
+        scan_dimacs(file_name, [](uint, uint) {}, add);
+    });
+
+}
+
+
+CompressedFeatures compressed_features(const CompressedAdjacency& adj) {
+
+    CompressedFeatures res;
+    const int n = adj.vertices();
+    if (n == 0) { return res; }
+
+    double triples = 0.0;
+    for (int v = 0; v < n; v++) {
+        const double d = adj.degree(v);
+        triples += d * (d - 1) / 2;
+    }
+    res.clustering_coefficient = (triples > 0) ? 3.0 * count_triangles(adj) / triples : 0.0;
+
+    res.spectral_radius = lanczos_adjacency(adj, 1, SpectrumEnd::largest).values.at(0);
+
+    BasicBreadthFirstSearch<CompressedAdjacency> bfs(adj);
+    bfs.run(0);
+    const auto reached = bfs.order();
+    res.diameter_lower_bound = bfs.run(reached[reached.size() - 1]);
+    return res;
+
+}
+
+
+const pair<double, double> clustering_coefficient_stream(string file_name, int budget, unsigned seed) {
+
+    unique_ptr<TransitivityStream> stream;
+    scan_dimacs(file_name,
+        [&](uint n, uint m) {
+            stream = make_unique<TransitivityStream>(n, TransitivityStream::colours_for_budget(m, budget), seed);
+        },
+        [&](int a, int b) {
+            if (!stream) { throw "Edge before problem line."; }
+            stream->add_edge(a, b);
+        });
+
+    if (!stream) { throw "Missing problem line."; }
+    auto res = stream->estimate();
+    return make_pair(res.value, res.variance);
 
 }
 
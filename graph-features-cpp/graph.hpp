@@ -4,6 +4,8 @@
 
 
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
 #include <string>
 #include <utility>
@@ -11,7 +13,14 @@
 
 #include "igraph/igraph.h"
 
+#include "adjacency.hpp"
+#include "compressed.hpp"
+#include "cores.hpp"
+#include "distance.hpp"
+#include "spectral.hpp"
+#include "triangles.hpp"
 #include "utils.hpp"
+#include "wl.hpp"
 
 
 namespace graph {
@@ -34,57 +43,107 @@ namespace graph {
             return impl::igraph_ptr(new igraph_t(), impl::del_igraph_t());
         }
 
-        inline igraph_ptr create_igraph_empty(int n) {
-            igraph_ptr graph = impl::create_igraph_ptr();
-            igraph_empty(graph.get(), n, IGRAPH_UNDIRECTED);
-            return graph;
-        }
+        // igraph form of a graph, converted on first use.
+        struct LazyIgraph {
+            std::once_flag converted;
+            igraph_ptr graph;
+        };
 
-        inline igraph_ptr create_igraph_copy(const igraph_ptr& other) {
-            igraph_ptr graph = impl::create_igraph_ptr();
-            igraph_copy(graph.get(), other.get());
-            return graph;
-        }
+        // DiameterTwo proof of a graph (empty where it does not hold), tried
+        // on first use.
+        struct LazyDiameterTwo {
+            std::once_flag proved;
+            std::optional<DiameterTwo> two;
+        };
+
+        // Immutable body of an UndirectedGraph, shared by its copies.
+        struct GraphData {
+            Adjacency core;
+            std::vector<uint32_t> self_loops;
+            mutable LazyIgraph lazy;
+            mutable LazyDiameterTwo diameter_two;
+
+            GraphData() = default;
+            GraphData(Adjacency core, std::vector<uint32_t> self_loops)
+                : core(std::move(core)), self_loops(std::move(self_loops)) {}
+        };
+
+        // The body of the graph without vertices, shared by every empty
+        // handle.
+        const std::shared_ptr<const GraphData>& empty_graph_data();
 
     }
 
 
+    // Undirected multigraph held natively as an immutable CSR Adjacency (32
+    // bit vertex ids, contiguous sorted neighbour lists) plus its self loops,
+    // which Adjacency drops. Native kernels read adjacency() directly; get()
+    // converts to igraph_t on first use (once, thread safe) for the features
+    // that still call igraph.
+    //
+    // Graphs are handles to a shared immutable body: copies (snapshots for
+    // feature tasks or mutation candidates) take O(1) and share the core,
+    // any igraph conversion and any DiameterTwo proof. Alteration is copy on
+    // write, building a new body for this handle only, so other copies are
+    // unaffected. Moves are O(1) too, and leave the source an empty graph.
+
     class UndirectedGraph {
 
-        impl::igraph_ptr graph;
+        std::shared_ptr<const impl::GraphData> data;
 
      public:
 
-        UndirectedGraph() { graph = impl::create_igraph_empty(0); }
-        UndirectedGraph(impl::igraph_ptr& g) { graph = move(g); }
-        explicit UndirectedGraph(int n) { graph = impl::create_igraph_empty(n); }
-        UndirectedGraph(const UndirectedGraph& a) { impl::create_igraph_copy(a.graph); }
-        UndirectedGraph(UndirectedGraph&& a) noexcept { graph = move(a.graph); }
-        ~UndirectedGraph() {}
-
-        UndirectedGraph& operator=(const UndirectedGraph& a) {
-            graph = impl::create_igraph_copy(a.graph);
+        UndirectedGraph() : data(impl::empty_graph_data()) {}
+        UndirectedGraph(impl::igraph_ptr& g);
+        explicit UndirectedGraph(int n) : data(std::make_shared<const impl::GraphData>(Adjacency(n, {}),
+                                                                                      std::vector<uint32_t>())) {}
+        UndirectedGraph(Adjacency core, std::vector<uint32_t> self_loops)
+            : data(std::make_shared<const impl::GraphData>(std::move(core), std::move(self_loops))) {}
+
+        UndirectedGraph(const UndirectedGraph&) = default;
+        UndirectedGraph& operator=(const UndirectedGraph&) = default;
+        UndirectedGraph(UndirectedGraph&& other) noexcept
+            : data(std::exchange(other.data, impl::empty_graph_data())) {}
+        UndirectedGraph& operator=(UndirectedGraph&& other) noexcept {
+            data = std::exchange(other.data, impl::empty_graph_data());
             return *this;
         }
 
-        UndirectedGraph& operator=(UndirectedGraph&& a) noexcept {
-            graph = move(a.graph);
-            return *this;
-        }
-
-        // Alterations.
-        void add_edge(int from, int to) { igraph_add_edge(graph.get(), from, to); }
+        // Alterations. Each rebuilds the CSR core in O(n + m), so add edges
+        // in bulk where possible, or build with GraphBuilder (builder.hpp).
+        void add_edge(int from, int to) { add_edges({{from, to}}); }
         void add_edges(std::vector<std::pair<int, int>> edges);
 
-        // Read only pointer for feature calculations.
-        const igraph_t* get() const { return graph.get(); }
+        // Whether both handles share one body (no copy was altered since).
+        bool shares(const UndirectedGraph& other) const { return data == other.data; }
+
+        // Read only igraph form for feature calculations through igraph.
+        const igraph_t* get() const;
+
+        // CSR adjacency for native traversal kernels.
+        const Adjacency& adjacency() const { return data->core; }
+
+        // DiameterTwo proof of adjacency(), or nullptr where it does not
+        // hold. Tried on first use (once, thread safe) and kept with the body,
+        // so the distance features here and in FeatureSet share one proof.
+        const DiameterTwo* diameter_two() const;
+
+        // The vertex of each self loop (which adjacency() drops).
+        const std::vector<uint32_t>& self_loops() const { return data->self_loops; }
 
         // Basic properties.
-        int vertices() const { return igraph_vcount(graph.get()); }
-        int edges() const { return igraph_ecount(graph.get()); }
+        int vertices() const { return data->core.vertices(); }
+        int edges() const { return data->core.entries() / 2 + data->self_loops.size(); }
 
     };
 
+    // igraph keeps global state (its error handling stack, f2c LAPACK and
+    // ARPACK) and is not thread safe. Code that may run concurrently (feature
+    // tasks, several graphs at once) holds this lock around every call that
+    // reaches igraph, including the first get() of a graph; the functions
+    // here do not take it themselves.
+    std::mutex& igraph_mutex();
+
     double density(const UndirectedGraph&);
     bool is_connected(const UndirectedGraph&);
 
@@ -96,21 +155,139 @@ namespace graph {
     double clustering_coefficient(const UndirectedGraph&);
     double algebraic_connectivity_arpack_dense(const UndirectedGraph&);
     double algebraic_connectivity_lapack_dense(const UndirectedGraph&);
+    double algebraic_connectivity_lanczos_sparse(const UndirectedGraph&);
+
+    // Dense LAPACK for small graphs, sparse Lanczos above a size threshold;
+    // the second form skips the connectivity check when that is known.
+    double algebraic_connectivity(const UndirectedGraph&);
+    double algebraic_connectivity(const UndirectedGraph&, bool connected);
+
+    // Extreme adjacency eigenvalues (sparse Lanczos, no full spectrum).
+    double spectral_radius(const UndirectedGraph&);
+    double smallest_adjacency_eigenvalue(const UndirectedGraph&);
     double wiener_index(const UndirectedGraph&);
 
+    // Sampled (estimate, standard error) pairs for large graph triage.
+    // Sources are added until the relative standard error is within the target.
+    const std::pair<double, double> average_path_length_sampled(
+        const UndirectedGraph&, double relative_error = 0.01, unsigned seed = 0);
+    const std::pair<double, double> wiener_index_sampled(
+        const UndirectedGraph&, double relative_error = 0.01, unsigned seed = 0);
+
+    // Sampled transitivity (estimate, variance) for large graph triage, from
+    // `samples` wedges, or in one pass over a DIMACS file holding about
+    // `budget` edges.
+    const std::pair<double, double> clustering_coefficient_sampled(
+        const UndirectedGraph&, int samples, unsigned seed = 0);
+    const std::pair<double, double> clustering_coefficient_stream(
+        std::string file_name, int budget, unsigned seed = 0);
+
     // Szeged, Revised Szeged index pair.
     const std::pair<double, double> szeged_indices(const UndirectedGraph&);
 
+    // Reuse a precomputed compact distance matrix (see also wiener_index(const DistanceMatrix&)).
+    const std::pair<double, double> szeged_indices(const UndirectedGraph&, const DistanceMatrix&);
+
+    // Streaming variants without the n x n distance matrix (threads 0 = all cores).
+    double wiener_index_streaming(const UndirectedGraph&, int threads = 0);
+    const std::pair<double, double> szeged_indices_streaming(const UndirectedGraph&, int threads = 0);
+
+    // Degeneracy (largest core number), the smallest-last vertex ordering,
+    // and the number of colours greedy colouring uses in that ordering: an
+    // upper bound on the chromatic number of at most degeneracy + 1.
+    int degeneracy(const UndirectedGraph&);
+    const std::vector<int> smallest_last_ordering(const UndirectedGraph&);
+    int smallest_last_colours(const UndirectedGraph&);
+
+    // Weisfeiler-Lehman fingerprint for detecting duplicate (identical or
+    // isomorphic) instances; see wl.hpp for what equal fingerprints imply.
+    const Hash128 wl_fingerprint(const UndirectedGraph&, int iterations = 3, int threads = 1);
+
+    // Edge list in canonical form: each edge as (min, max), sorted, with
+    // multiplicity. Equal lists (and vertex counts) mean identical graphs,
+    // the same edges on the same vertex numbering; canonical_hash hashes
+    // both, so equal hashes only make graphs candidates for identity.
+    const std::vector<std::pair<int, int>> canonical_edges(const UndirectedGraph&);
+    const Hash128 canonical_hash(const UndirectedGraph&);
+
+    // WL subtree features: for refinements 1 .. iterations, the fraction of
+    // vertices in each of `width` hashed label bins (row i - 1 for refinement i).
+    const std::vector<std::vector<double>> wl_histograms(
+        const UndirectedGraph&, int iterations = 3, int width = 8, int threads = 1);
+
     // Vertex and eigenvalue properties.
     const igraphVector degree(const UndirectedGraph&);
+    const igraphVector core_number(const UndirectedGraph&);
     const igraphVector betweenness_centrality(const UndirectedGraph&);
+    // Eigenvector centrality (scaled to a maximum of one) by native Lanczos,
+    // which needs no igraph_mutex; the ARPACK form (through igraph, counting
+    // self loops) is kept for comparison.
     const igraphVector eigenvector_centrality(const UndirectedGraph&);
+    const igraphVector eigenvector_centrality_arpack(const UndirectedGraph&);
+    const igraphVector eigenvector_centrality_lanczos(const UndirectedGraph&);
     const igraphVector adjacency_eigenvalues(const UndirectedGraph&);
+    const igraphVector eccentricity(const UndirectedGraph&);
+    const igraphVector local_clustering_coefficient(const UndirectedGraph&);
 
-    // Energy, stdev, beta bipartitivity tuple.
+    // Energy, stdev, beta bipartitivity tuple, from the graph or from its
+    // adjacency_eigenvalues.
     const std::tuple<double, double, double> adjacency_eigenvalue_stats(const UndirectedGraph&);
+    const std::tuple<double, double, double> adjacency_eigenvalue_stats(const std::vector<double>& eigenvalues);
 
     UndirectedGraph read_dimacs(std::string);
+
+    // Loading options: with simplify, each edge is taken as (min, max),
+    // duplicates and self loops are removed (by a radix sort split over
+    // threads, 0 = hardware concurrency), and an edge count differing from
+    // the problem line is accepted instead of failing.
+    struct DimacsOptions {
+        bool simplify = false;
+        int threads = 1;
+    };
+
+    struct DimacsReport {
+        int declared_edges = 0;
+        int edge_lines = 0;
+        int duplicate_edges = 0;
+        int self_loops = 0;
+    };
+
+    UndirectedGraph read_dimacs(std::string, const DimacsOptions&, DimacsReport* report = nullptr);
+
+    // Vertices and edges from the problem line only, without reading edges.
+    const std::pair<int, int> read_dimacs_size(std::string);
+
+    // Triage features from a single scan of a DIMACS file, using a degree
+    // array and union-find instead of building the graph.
+    struct QuickFeatures {
+        int vertices = 0;
+        int edges = 0;
+        double density = 0.0;
+        double degree_mean = 0.0;
+        double degree_stdev = 0.0;
+        int components = 0;
+        bool connected = false;
+    };
+
+    QuickFeatures read_dimacs_quick(std::string);
+
+    // Read straight into compressed adjacency, for instances too large to
+    // hold as an UndirectedGraph. Native kernels (BFS, triangles, Lanczos)
+    // run on the result directly.
+    CompressedAdjacency read_dimacs_compressed(std::string);
+
+    // Triage features needing the whole graph, from compressed adjacency:
+    // exact transitivity (from the triangle count), the spectral radius (by
+    // Lanczos), and a lower bound on the diameter of the component of vertex
+    // 0 (a double sweep: BFS from 0, then from the last vertex reached).
+    struct CompressedFeatures {
+        double clustering_coefficient = 0.0;
+        double spectral_radius = 0.0;
+        int diameter_lower_bound = 0;
+    };
+
+    CompressedFeatures compressed_features(const CompressedAdjacency&);
+
     UndirectedGraph random_tree(int vertices, int children);
     UndirectedGraph random_bipartite(int n1, int n2, double p);
     UndirectedGraph erdos_renyi_gnm(int n, int m);
@@ -0,0 +1,25 @@
+
+#ifndef HASH_HPP
+#define HASH_HPP
+
+
+#include <cstdint>
+
+
+namespace graph {
+
+
+    // SplitMix64 finaliser (Steele, Lea & Flood 2014): a fast bijective mix
+    // of 64 bit keys, used for hash colourings and label hashing.
+    inline uint64_t splitmix64(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+
+}
+
+
+#endif
@@ -0,0 +1,56 @@
+
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "scheduler.hpp"
+
+
+namespace graph {
+
+
+    // Split items 0 .. n-1 into contiguous chunks, one per thread (0 = hardware
+    // concurrency), calling work(thread_index, begin, end). Runs inline for a
+    // single thread. Called from a ThreadPool, the chunks are jobs on that
+    // pool rather than new threads; chunk boundaries are the same either way.
+    // The first exception thrown by work is rethrown once all chunks end.
+    template<class Work>
+    void parallel_ranges(int n, int threads, Work work) {
+        if (threads <= 0) { threads = std::max(1u, std::thread::hardware_concurrency()); }
+        threads = std::max(1, std::min(threads, n));
+        if (threads == 1) {
+            work(0, 0, n);
+            return;
+        }
+        if (ThreadPool* pool = ThreadPool::current()) {
+            pool->parallel_for(threads, [&](int t) { work(t, t * n / threads, (t + 1) * n / threads); });
+            return;
+        }
+        std::mutex error_lock;
+        std::exception_ptr error;
+        std::vector<std::thread> pool;
+        for (int t = 0; t < threads; t++) {
+            pool.emplace_back([&, t]() {
+                try {
+                    work(t, t * n / threads, (t + 1) * n / threads);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error) { error = std::current_exception(); }
+                }
+            });
+        }
+        for (auto& worker : pool) { worker.join(); }
+        if (error) { std::rethrow_exception(error); }
+    }
+
+
+}
+
+
+#endif
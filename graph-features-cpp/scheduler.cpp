@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <exception>
+
+#include "gsl/gsl_assert"
+#include "scheduler.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    // Pool and deque of the calling thread (index -1 outside the workers),
+    // and the number of jobs running on its stack.
+    thread_local ThreadPool* current_pool = nullptr;
+    thread_local int current_index = -1;
+    thread_local int current_depth = 0;
+
+    // Makes pool current on a thread that is not one of its workers, for
+    // the lifetime of the guard.
+    class Helping {
+        ThreadPool* const outer_pool;
+        const int outer_index;
+     public:
+        explicit Helping(ThreadPool* pool) : outer_pool(current_pool), outer_index(current_index) {
+            if (current_pool != pool) {
+                current_pool = pool;
+                current_index = -1;
+            }
+        }
+        ~Helping() {
+            current_pool = outer_pool;
+            current_index = outer_index;
+        }
+    };
+
+}
+
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    for (int i = 0; i < threads - 1; i++) {
+        deques.push_back(make_unique<WorkStealingDeque<Job*>>());
+    }
+    for (int i = 0; i < threads - 1; i++) {
+        workers.emplace_back([this, i]() { work(i); });
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    for (auto& worker : workers) { worker.join(); }
+    for (Job* job : shared) { delete job; }
+    for (Job* job : shared_nested) { delete job; }
+}
+
+
+ThreadPool* ThreadPool::current() {
+    return current_pool;
+}
+
+
+ThreadPool::Job* ThreadPool::find(int self) {
+    if (self >= 0) {
+        if (auto job = deques[self]->pop()) { return *job; }
+    }
+    // Steal, starting after this worker so thieves spread over victims.
+    const int count = deques.size();
+    for (int i = 1; i <= count; i++) {
+        const int victim = (self + i + count) % count;
+        if (victim == self) { continue; }
+        if (auto job = deques[victim]->steal()) { return *job; }
+    }
+    // Parts of running jobs first; top-level jobs only outside any job.
+    lock_guard<mutex> guard(lock);
+    auto take = [](deque<Job*>& queue) {
+        Job* job = queue.front();
+        queue.pop_front();
+        return job;
+    };
+    if (!shared_nested.empty()) { return take(shared_nested); }
+    if (current_depth == 0 && !shared.empty()) { return take(shared); }
+    return nullptr;
+}
+
+
+void ThreadPool::run(Job* job) {
+    current_depth++;
+    (*job)();
+    current_depth--;
+    delete job;
+    {
+        lock_guard<mutex> guard(lock);
+        epoch++;
+    }
+    changed.notify_all();
+}
+
+
+void ThreadPool::work(int self) {
+    current_pool = this;
+    current_index = self;
+    while (true) {
+        uint64_t seen;
+        {
+            lock_guard<mutex> guard(lock);
+            if (stopping) { return; }
+            seen = epoch;
+        }
+        if (Job* job = find(self)) {
+            run(job);
+            continue;
+        }
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&]() { return stopping || epoch != seen; });
+    }
+}
+
+
+void ThreadPool::spawn(Job job) {
+    Job* pending = new Job(move(job));
+    const bool own = (current_pool == this && current_index >= 0);
+    if (own) { deques[current_index]->push(pending); }
+    {
+        lock_guard<mutex> guard(lock);
+        if (!own) { (current_depth > 0 ? shared_nested : shared).push_back(pending); }
+        epoch++;
+    }
+    changed.notify_all();
+}
+
+
+void ThreadPool::help_until(const function<bool()>& done) {
+    Helping helping(this);
+    while (true) {
+        uint64_t seen;
+        {
+            lock_guard<mutex> guard(lock);
+            seen = epoch;
+        }
+        if (done()) { break; }
+        if (Job* job = find(current_index)) {
+            run(job);
+            continue;
+        }
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&]() { return epoch != seen; });
+    }
+}
+
+
+void ThreadPool::parallel_for(int count, const function<void(int)>& body) {
+    Helping helping(this);
+    atomic<int> remaining{count};
+    mutex error_lock;
+    exception_ptr error;
+    auto job = [&](int i) {
+        try {
+            body(i);
+        } catch (...) {
+            lock_guard<mutex> guard(error_lock);
+            if (!error) { error = current_exception(); }
+        }
+        remaining--;
+    };
+    for (int i = 1; i < count; i++) {
+        spawn([&job, i]() { job(i); });
+    }
+    if (count > 0) { job(0); }
+    help_until([&]() { return remaining == 0; });
+    if (error) { rethrow_exception(error); }
+}
+
+
+int TaskGraph::add(function<void()> work, const vector<int>& after) {
+    const int id = tasks.size();
+    Task task;
+    task.work = move(work);
+    for (const int before : after) {
+        Expects(before >= 0 && before < id);
+        tasks[before].dependants.push_back(id);
+        task.dependencies++;
+    }
+    tasks.push_back(move(task));
+    return id;
+}
+
+
+void TaskGraph::run(ThreadPool& pool) const {
+
+    // Each task spawns the dependants it makes ready. After an error the
+    // remaining tasks are skipped, but still counted as finished.
+    vector<atomic<int>> waiting(tasks.size());
+    atomic<int> finished{0};
+    atomic<bool> failed{false};
+    mutex error_lock;
+    exception_ptr error;
+
+    function<void(int)> launch = [&](int id) {
+        pool.spawn([&, id]() {
+            if (!failed) {
+                try {
+                    tasks[id].work();
+                } catch (...) {
+                    lock_guard<mutex> guard(error_lock);
+                    if (!error) { error = current_exception(); }
+                    failed = true;
+                }
+            }
+            for (const int next : tasks[id].dependants) {
+                if (--waiting[next] == 0) { launch(next); }
+            }
+            finished++;
+        });
+    };
+
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+        waiting[i] = tasks[i].dependencies;
+    }
+    for (std::size_t i = 0; i < tasks.size(); i++) {
+        if (tasks[i].dependencies == 0) { launch(i); }
+    }
+    pool.help_until([&]() { return finished == (int) tasks.size(); });
+    if (error) { rethrow_exception(error); }
+
+}
+
+
+void TaskGraph::run(int threads) const {
+    if (threads <= 0) { threads = max(1u, thread::hardware_concurrency()); }
+    if (threads == 1 || tasks.size() <= 1) {
+        for (const auto& task : tasks) { task.work(); }
+        return;
+    }
+    if (ThreadPool* pool = ThreadPool::current()) {
+        run(*pool);
+        return;
+    }
+    ThreadPool pool(min<int>(threads, tasks.size()));
+    run(pool);
+}
+
+
+}
@@ -0,0 +1,202 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+
+namespace graph {
+
+
+    // Chase-Lev work-stealing deque (Chase & Lev 2005, with the memory
+    // orderings of Le et al. 2013). The owning thread pushes and pops at the
+    // bottom; other threads steal from the top, so a single compare-and-swap
+    // on top arbitrates only between thieves and a pop of the last item. The
+    // array doubles when full; retired arrays are kept until destruction so a
+    // thief never reads freed memory. T must be trivially copyable.
+
+    template<class T>
+    class WorkStealingDeque {
+
+        struct Array {
+            std::size_t mask;
+            std::unique_ptr<std::atomic<T>[]> slots;
+            explicit Array(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<T>[capacity]) {}
+            std::size_t capacity() const { return mask + 1; }
+            T get(int64_t i) const { return slots[i & mask].load(std::memory_order_relaxed); }
+            void put(int64_t i, T x) { slots[i & mask].store(x, std::memory_order_relaxed); }
+        };
+
+        std::atomic<int64_t> top{0};
+        std::atomic<int64_t> bottom{0};
+        std::atomic<Array*> array;
+        std::vector<std::unique_ptr<Array>> arrays;
+
+     public:
+
+        // Capacity must be a power of two.
+        explicit WorkStealingDeque(std::size_t capacity = 64) {
+            arrays.push_back(std::make_unique<Array>(capacity));
+            array.store(arrays.back().get(), std::memory_order_relaxed);
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only.
+        void push(T x) {
+            const int64_t b = bottom.load(std::memory_order_relaxed);
+            const int64_t t = top.load(std::memory_order_acquire);
+            Array* a = array.load(std::memory_order_relaxed);
+            if (b - t > (int64_t) a->capacity() - 1) {
+                arrays.push_back(std::make_unique<Array>(2 * a->capacity()));
+                for (int64_t i = t; i < b; i++) { arrays.back()->put(i, a->get(i)); }
+                a = arrays.back().get();
+                array.store(a, std::memory_order_release);
+            }
+            a->put(b, x);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only: the newest item.
+        std::optional<T> pop() {
+            const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            Array* a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+            if (t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+            const T x = a->get(b);
+            if (t == b) {
+                // Last item: race thieves for it.
+                const bool won = top.compare_exchange_strong(
+                    t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                if (!won) { return std::nullopt; }
+            }
+            return x;
+        }
+
+        // Any thread: the oldest item. Empty on losing a race as well.
+        std::optional<T> steal() {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) { return std::nullopt; }
+            const T x = array.load(std::memory_order_acquire)->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return std::nullopt;
+            }
+            return x;
+        }
+
+    };
+
+
+    // Workers each with a WorkStealingDeque of jobs. A job spawned on a
+    // worker goes on its own deque and is run newest first by that worker,
+    // while idle workers steal the oldest jobs of others; jobs spawned from
+    // other threads go on a shared queue. Threads waiting in help_until run
+    // jobs too, so nested parallelism (jobs that spawn and wait for jobs)
+    // neither deadlocks nor idles: the pool starts threads - 1 workers, with
+    // the waiting thread making up the last. Top-level jobs (spawned from
+    // outside any job) are only started by threads not inside a job, so a
+    // job waiting on its own parts never runs a new top-level job on its
+    // stack. Jobs must not throw.
+
+    class ThreadPool {
+
+        using Job = std::function<void()>;
+
+        std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> deques;
+        std::vector<std::thread> workers;
+        std::mutex lock;
+        std::condition_variable changed;
+        uint64_t epoch = 0;
+        bool stopping = false;
+        std::deque<Job*> shared;
+        std::deque<Job*> shared_nested;
+
+        Job* find(int self);
+        void run(Job*);
+        void work(int self);
+
+     public:
+
+        // threads 0 = hardware concurrency.
+        explicit ThreadPool(int threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        int size() const { return workers.size() + 1; }
+
+        void spawn(Job job);
+
+        // Runs jobs on the calling thread until done() holds. done is checked
+        // after every job anywhere in the pool finishes.
+        void help_until(const std::function<bool()>& done);
+
+        // Runs body(0 .. count-1) as jobs and waits for them, rethrowing the
+        // first exception thrown.
+        void parallel_for(int count, const std::function<void(int)>& body);
+
+        // The pool the calling thread is working for (as a worker or in
+        // help_until), or nullptr.
+        static ThreadPool* current();
+
+    };
+
+
+    // Tasks with dependencies: a task starts once every task it was added
+    // after has finished, so independent tasks run concurrently. If a task
+    // throws, no further tasks start and run() rethrows the first exception
+    // once the running ones have finished.
+
+    class TaskGraph {
+
+        struct Task {
+            std::function<void()> work;
+            std::vector<int> dependants;
+            int dependencies = 0;
+        };
+
+        std::vector<Task> tasks;
+
+     public:
+
+        // Returns the new task's id. Dependencies must already have been
+        // added, so ids are a topological order.
+        int add(std::function<void()> work, const std::vector<int>& after = {});
+
+        int size() const { return tasks.size(); }
+
+        // Runs every task on the pool.
+        void run(ThreadPool&) const;
+
+        // Runs every task on the current pool if called from one, otherwise
+        // on a pool of threads (0 = hardware concurrency). A single thread
+        // runs them inline in the order added.
+        void run(int threads) const;
+
+    };
+
+
+}
+
+
+#endif
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "gsl/gsl_assert"
+#include "spectral.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    double dot(const vector<double>& a, const vector<double>& b) {
+        double res = 0.0;
+        for (std::size_t i = 0; i < a.size(); i++) { res += a[i] * b[i]; }
+        return res;
+    }
+
+    // y += alpha * x
+    void axpy(double alpha, const vector<double>& x, vector<double>& y) {
+        for (std::size_t i = 0; i < x.size(); i++) { y[i] += alpha * x[i]; }
+    }
+
+    double normalise(vector<double>& x) {
+        double norm = sqrt(dot(x, x));
+        if (norm > 0) {
+            for (auto& xi : x) { xi /= norm; }
+        }
+        return norm;
+    }
+
+    // Remove components along an orthonormal set (applied twice for stability).
+    void orthogonalise(vector<double>& w, const vector<vector<double>>& basis) {
+        for (int pass = 0; pass < 2; pass++) {
+            for (const auto& b : basis) { axpy(-dot(b, w), b, w); }
+        }
+    }
+
+    // Random unit vector orthogonal to both sets.
+    vector<double> random_direction(int n, mt19937& rng,
+                                    const vector<vector<double>>& deflate, const vector<vector<double>>& basis) {
+        uniform_real_distribution<double> draw(-1.0, 1.0);
+        vector<double> x(n);
+        do {
+            for (auto& xi : x) { xi = draw(rng); }
+            orthogonalise(x, deflate);
+            orthogonalise(x, basis);
+        } while (normalise(x) < 1e-8);
+        return x;
+    }
+
+    // Dense symmetric eigensolve of the projected matrix (its upper triangle;
+    // ascending values, column eigenvectors) by cyclic Jacobi rotations.
+    // Native rather than LAPACK through igraph, whose global state would
+    // otherwise serialise every Lanczos caller behind igraph_mutex; the
+    // matrix is small (m of a few dozen), where Jacobi is cheap and accurate
+    // to rounding.
+    void projected_eigen(const vector<double>& H, int m, vector<double>& theta, vector<double>& Y) {
+        vector<double> A(m * m), V(m * m, 0.0);
+        double norm = 0.0;
+        for (int i = 0; i < m; i++) {
+            for (int j = 0; j < m; j++) {
+                A[i * m + j] = (i <= j) ? H[i * m + j] : H[j * m + i];
+                norm += A[i * m + j] * A[i * m + j];
+            }
+            V[i * m + i] = 1.0;
+        }
+        for (int sweep = 0; sweep < 64; sweep++) {
+            double off = 0.0;
+            for (int p = 0; p < m; p++) {
+                for (int q = p + 1; q < m; q++) { off += 2 * A[p * m + q] * A[p * m + q]; }
+            }
+            if (off <= 1e-30 * norm) { break; }
+            for (int p = 0; p < m; p++) {
+                for (int q = p + 1; q < m; q++) {
+                    const double apq = A[p * m + q];
+                    if (apq == 0.0) { continue; }
+                    // Rotation by the smaller angle that zeroes A[p][q].
+                    const double phi = (A[q * m + q] - A[p * m + p]) / (2 * apq);
+                    const double t = (phi >= 0 ? 1.0 : -1.0) / (fabs(phi) + sqrt(phi * phi + 1));
+                    const double c = 1 / sqrt(t * t + 1), s = t * c;
+                    auto rotate = [&](double& x, double& y) {
+                        const double u = x, v = y;
+                        x = c * u - s * v;
+                        y = s * u + c * v;
+                    };
+                    for (int k = 0; k < m; k++) { rotate(A[k * m + p], A[k * m + q]); }
+                    for (int k = 0; k < m; k++) { rotate(A[p * m + k], A[q * m + k]); }
+                    for (int k = 0; k < m; k++) { rotate(V[k * m + p], V[k * m + q]); }
+                }
+            }
+        }
+        vector<int> order(m);
+        iota(order.begin(), order.end(), 0);
+        sort(order.begin(), order.end(), [&](int a, int b) { return A[a * m + a] < A[b * m + b]; });
+        theta.resize(m);
+        Y.resize(m * m);
+        for (int j = 0; j < m; j++) {
+            theta[j] = A[order[j] * m + order[j]];
+            for (int i = 0; i < m; i++) { Y[i * m + j] = V[i * m + order[j]]; }
+        }
+    }
+
+    // Indices of the wanted Ritz values (ascending order) out of m, taking
+    // `count` from the requested end(s).
+    vector<int> select(int m, int count, SpectrumEnd end) {
+        vector<int> res;
+        int low = (end == SpectrumEnd::largest) ? 0 : (end == SpectrumEnd::both) ? (count + 1) / 2 : count;
+        int high = count - low;
+        for (int i = 0; i < min(low, m); i++) { res.push_back(i); }
+        for (int i = max(low, m - high); i < m; i++) { res.push_back(i); }
+        return res;
+    }
+
+    template<class Operator>
+    Eigenpairs thick_restart_lanczos(int n, Operator apply, int k, SpectrumEnd end,
+                                     const vector<vector<double>>& deflate, double tolerance, unsigned seed) {
+
+        Expects(k > 0);
+        Eigenpairs res;
+
+        // Dimension of the space being searched and of the Krylov basis.
+        const int space = n - deflate.size();
+        const int wanted = min(space, (end == SpectrumEnd::both) ? 2 * k : k);
+        if (wanted <= 0) {
+            res.converged = true;
+            return res;
+        }
+        const int m = min(space, max(2 * wanted + 20, 30));
+        const int max_restarts = 1000;
+
+        mt19937 rng(seed);
+        vector<vector<double>> V;
+        V.reserve(m + 1);
+        V.push_back(random_direction(n, rng, deflate, V));
+
+        vector<double> H(m * m, 0.0), theta, Y, w;
+        double beta = 0.0;
+        bool breakdown = false;
+
+        for (int restart = 0; ; restart++) {
+
+            // Extend the basis to m vectors; H holds V' A V.
+            for (int j = V.size() - 1; j < m; j++) {
+                w = apply(V[j]);
+                res.matvecs++;
+                const double scale = sqrt(dot(w, w));
+                orthogonalise(w, deflate);
+                for (int pass = 0; pass < 2; pass++) {
+                    for (int i = 0; i <= j; i++) {
+                        double h = dot(V[i], w);
+                        H[i * m + j] += h;
+                        H[j * m + i] = H[i * m + j];
+                        axpy(-h, V[i], w);
+                    }
+                }
+                // Cancellation leaves rounding noise along deflated directions.
+                orthogonalise(w, deflate);
+                beta = sqrt(dot(w, w));
+                breakdown = beta <= 1e-10 * scale;
+                if (j + 1 < m) {
+                    if (breakdown) {
+                        // Invariant subspace: continue from a fresh direction.
+                        V.push_back(random_direction(n, rng, deflate, V));
+                    } else {
+                        V.push_back(w);
+                        normalise(V.back());
+                    }
+                }
+            }
+
+            projected_eigen(H, m, theta, Y);
+
+            // Ritz residual |A x - theta x| = beta |last component of y|.
+            const auto chosen = select(m, wanted, end);
+            bool converged = (m == space);
+            if (!converged) {
+                converged = all_of(chosen.begin(), chosen.end(), [&](int i) {
+                    return beta * fabs(Y[(m - 1) * m + i]) <= tolerance * max(1.0, fabs(theta[i]));
+                });
+            }
+
+            auto ritz_vector = [&](int i) {
+                vector<double> x(n, 0.0);
+                for (int j = 0; j < m; j++) { axpy(Y[j * m + i], V[j], x); }
+                return x;
+            };
+
+            if (converged || restart == max_restarts) {
+                for (const int i : chosen) {
+                    auto x = ritz_vector(i);
+                    normalise(x);
+                    auto ax = apply(x);
+                    res.matvecs++;
+                    axpy(-theta[i], x, ax);
+                    res.values.push_back(theta[i]);
+                    res.residuals.push_back(sqrt(dot(ax, ax)));
+                    res.vectors.push_back(move(x));
+                }
+                res.converged = converged;
+                return res;
+            }
+
+            // Thick restart: keep the wanted Ritz vectors and about half of
+            // the remaining space nearest to them, then the residual direction.
+            const auto keep = select(m, min(m - 1, wanted + (m - wanted) / 2), end);
+            vector<vector<double>> kept;
+            kept.reserve(m + 1);
+            for (const int i : keep) { kept.push_back(ritz_vector(i)); }
+            fill(H.begin(), H.end(), 0.0);
+            for (std::size_t a = 0; a < keep.size(); a++) { H[a * m + a] = theta[keep[a]]; }
+            if (breakdown) {
+                kept.push_back(random_direction(n, rng, deflate, kept));
+            } else {
+                kept.push_back(w);
+                normalise(kept.back());
+            }
+            V = move(kept);
+        }
+    }
+
+    // Sparse products y = A x and y = L x over either adjacency structure.
+    template<class Graph>
+    auto adjacency_product(const Graph& adj) {
+        return [&adj](const vector<double>& x) {
+            const int n = adj.vertices();
+            vector<double> y(n);
+            for (int u = 0; u < n; u++) {
+                double sum = 0.0;
+                for (const auto v : adj.neighbours(u)) { sum += x[v]; }
+                y[u] = sum;
+            }
+            return y;
+        };
+    }
+
+    template<class Graph>
+    auto laplacian_product(const Graph& adj) {
+        return [&adj](const vector<double>& x) {
+            const int n = adj.vertices();
+            vector<double> y(n);
+            for (int u = 0; u < n; u++) {
+                double sum = adj.degree(u) * x[u];
+                for (const auto v : adj.neighbours(u)) { sum -= x[v]; }
+                y[u] = sum;
+            }
+            return y;
+        };
+    }
+
+    template<class Graph>
+    Eigenpairs laplacian_pairs(const Graph& adj, int k, SpectrumEnd end, bool deflate_constant,
+                               double tolerance, unsigned seed) {
+        const int n = adj.vertices();
+        vector<vector<double>> deflate;
+        if (deflate_constant && n > 0) {
+            deflate.emplace_back(n, 1.0 / sqrt(double(n)));
+        }
+        return thick_restart_lanczos(n, laplacian_product(adj), k, end, deflate, tolerance, seed);
+    }
+
+}
+
+
+Eigenpairs lanczos_adjacency(const Adjacency& adj, int k, SpectrumEnd end, double tolerance, unsigned seed) {
+    return thick_restart_lanczos(adj.vertices(), adjacency_product(adj), k, end, {}, tolerance, seed);
+}
+
+
+Eigenpairs lanczos_adjacency(const CompressedAdjacency& adj, int k, SpectrumEnd end, double tolerance, unsigned seed) {
+    return thick_restart_lanczos(adj.vertices(), adjacency_product(adj), k, end, {}, tolerance, seed);
+}
+
+
+Eigenpairs lanczos_laplacian(const Adjacency& adj, int k, SpectrumEnd end, bool deflate_constant,
+                             double tolerance, unsigned seed) {
+    return laplacian_pairs(adj, k, end, deflate_constant, tolerance, seed);
+}
+
+
+Eigenpairs lanczos_laplacian(const CompressedAdjacency& adj, int k, SpectrumEnd end, bool deflate_constant,
+                             double tolerance, unsigned seed) {
+    return laplacian_pairs(adj, k, end, deflate_constant, tolerance, seed);
+}
+
+
+}
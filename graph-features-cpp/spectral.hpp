@@ -0,0 +1,54 @@
+
+#ifndef SPECTRAL_HPP
+#define SPECTRAL_HPP
+
+
+#include <vector>
+
+#include "adjacency.hpp"
+#include "compressed.hpp"
+
+
+namespace graph {
+
+
+    // Which end(s) of the spectrum to compute.
+    enum class SpectrumEnd { largest, smallest, both };
+
+    // Eigenpairs in ascending order of eigenvalue. Residuals are the explicit
+    // norms |A x - theta x| of the returned (unit) vectors; converged is false
+    // if the restart limit was hit before every requested pair met tolerance.
+    struct Eigenpairs {
+        std::vector<double> values;
+        std::vector<std::vector<double>> vectors;
+        std::vector<double> residuals;
+        int matvecs = 0;
+        bool converged = false;
+    };
+
+    // Thick-restart Lanczos (Wu & Simon) for the k largest and/or smallest
+    // eigenpairs of the adjacency or Laplacian matrix, using only sparse
+    // matrix-vector products over the CSR adjacency. Each cycle extends a basis
+    // of about 2k + 20 vectors with full reorthogonalisation, solves the small
+    // projected problem, and restarts from the wanted Ritz vectors plus the
+    // residual direction. A pair is accepted once its Ritz residual is within
+    // tolerance * max(1, |theta|).
+    //
+    // deflate_constant keeps the search orthogonal to the all-ones vector, so
+    // the smallest Laplacian eigenpair found is the second smallest overall for
+    // a connected graph.
+    Eigenpairs lanczos_adjacency(const Adjacency&, int k, SpectrumEnd, double tolerance = 1e-10, unsigned seed = 0);
+    Eigenpairs lanczos_laplacian(const Adjacency&, int k, SpectrumEnd, bool deflate_constant,
+                                 double tolerance = 1e-10, unsigned seed = 0);
+
+    // The same on compressed adjacency, decoding neighbours in each product.
+    Eigenpairs lanczos_adjacency(const CompressedAdjacency&, int k, SpectrumEnd,
+                                 double tolerance = 1e-10, unsigned seed = 0);
+    Eigenpairs lanczos_laplacian(const CompressedAdjacency&, int k, SpectrumEnd, bool deflate_constant,
+                                 double tolerance = 1e-10, unsigned seed = 0);
+
+
+}
+
+
+#endif
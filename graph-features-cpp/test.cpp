@@ -1,6 +1,15 @@
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <random>
 
+#include "gsl/gsl_assert"
+#include "builder.hpp"
+#include "featureset.hpp"
 #include "graph.hpp"
 
 using namespace std;
@@ -11,28 +20,65 @@ void print_features(const UndirectedGraph& g) {
     cout << " 1. Vertices:              " << g.vertices() << endl;
     cout << " 2. Edges:                 " << g.edges() << endl;
     cout << " 3. Density:               " << density(g) << endl;
-    auto [ mean, stdev ] = simple_statistics(degree(g));
-    cout << " 4. Degree Mean:           " << mean << endl;
-    cout << " 5. Degree StDev:          " << stdev << endl;
+    Moments stats = moment_statistics(degree(g));
+    cout << " 4. Degree Mean:           " << stats.mean << endl;
+    cout << " 5. Degree StDev:          " << stats.stdev << endl;
+    print_distribution(cout, "Degree", stats);
+    cout << "    Degeneracy:            " << degeneracy(g) << endl;
+    auto [ mean, stdev ] = simple_statistics(core_number(g));
+    cout << "    Core Number Mean:      " << mean << endl;
+    cout << "    Core Number StDev:     " << stdev << endl;
+    cout << "    Smallest Last Colours: " << smallest_last_colours(g) << endl;
     cout << " 6. Average Path Length:   " << average_path_length(g) << endl;
+    auto [ apl, apl_error ] = average_path_length_sampled(g, 0.05);
+    cout << "    Sampled APL:           " << apl << " +- " << apl_error << endl;
     cout << " 7. Diameter:              " << diameter(g) << endl;
+    cout << "    Radius:                " << radius(g) << endl;
+    tie( mean, stdev ) = simple_statistics(eccentricity(g));
+    cout << "    Eccentricity Mean:     " << mean << endl;
+    cout << "    Eccentricity StDev:    " << stdev << endl;
     cout << " 8. Girth:                 " << girth(g) << endl;
-    tie( mean, stdev ) = simple_statistics(betweenness_centrality(g));
-    cout << " 9. B Centrality Mean:     " << mean << endl;
-    cout << "10. B Centrality StDev:    " << stdev << endl;
+    stats = moment_statistics(betweenness_centrality(g));
+    cout << " 9. B Centrality Mean:     " << stats.mean << endl;
+    cout << "10. B Centrality StDev:    " << stats.stdev << endl;
+    print_distribution(cout, "B Centrality", stats);
     cout << "11. Clustering Coeff:      " << clustering_coefficient(g) << endl;
+    auto [ cc, cc_variance ] = clustering_coefficient_sampled(g, 10000);
+    cout << "    Clustering (sampled):  " << cc << " +- " << sqrt(cc_variance) << endl;
     auto [ szeged, revised_szeged ] = szeged_indices(g);
     cout << "12. Szeged Index:          " << szeged << endl;
     cout << "    Revised Szeged Index:  " << revised_szeged << endl;
+    tie( szeged, revised_szeged ) = szeged_indices_streaming(g);
+    cout << "    Szeged (streaming):    " << szeged << endl;
+    cout << "    Revised (streaming):   " << revised_szeged << endl;
+    cout << "    Wiener Index:          " << wiener_index(g) << endl;
+    const DistanceMatrix distance(g.adjacency());
+    cout << "    Wiener (matrix):       " << wiener_index(distance) << endl;
+    tie( szeged, revised_szeged ) = szeged_indices(g, distance);
+    cout << "    Szeged (matrix):       " << szeged << endl;
+    cout << "    Wiener (streaming):    " << wiener_index_streaming(g) << endl;
     auto [ energy, eig_stdev, beta ] = adjacency_eigenvalue_stats(g);
     cout << "13. Beta:                  " << beta << endl;
     cout << "14. Energy:                " << energy << endl;
     cout << "15. Eigenvalue StDev:      " << eig_stdev << endl;
     cout << "16. Alg. Connectivity:     " << algebraic_connectivity_lapack_dense(g) << endl;
     cout << "    Alg. Connectivity:     " << algebraic_connectivity_arpack_dense(g) << endl;
-    tie( mean, stdev ) = simple_statistics(eigenvector_centrality(g));
-    cout << "17. E Centrality Mean:     " << mean << endl;
-    cout << "18. E Centrality StDev:    " << stdev << endl;
+    cout << "    Alg. Connectivity:     " << algebraic_connectivity_lanczos_sparse(g) << endl;
+    cout << "    Spectral Radius:       " << spectral_radius(g) << endl;
+    cout << "    Smallest Eigenvalue:   " << smallest_adjacency_eigenvalue(g) << endl;
+    stats = moment_statistics(eigenvector_centrality(g));
+    cout << "17. E Centrality Mean:     " << stats.mean << endl;
+    cout << "18. E Centrality StDev:    " << stats.stdev << endl;
+    print_distribution(cout, "E Centrality", stats);
+    const auto histograms = wl_histograms(g);
+    for (std::size_t i = 0; i < histograms.size(); i++) {
+        for (std::size_t bin = 0; bin < histograms[i].size(); bin++) {
+            cout << "    WL Histogram " << i + 1 << "." << bin << ":      " << histograms[i][bin] << endl;
+        }
+    }
+    tie( mean, stdev ) = simple_statistics(eigenvector_centrality_arpack(g));
+    cout << "    E Centrality Mean:     " << mean << endl;
+    cout << "    E Centrality StDev:    " << stdev << endl;
 }
 
 
@@ -43,9 +89,9 @@ int main() {
     // Set number of vertices N.
     auto g = UndirectedGraph(5);
     // Add edges as an adjacency list (numbering is 0 .. N-1).
-    // (i, j) ordering doesn't matter, but be aware that igraph
-    // will count edges multiple times if they are added more than
-    // once in any order (TO FIX).
+    // (i, j) ordering doesn't matter, but edges added more than
+    // once in any order are counted multiple times; to remove them
+    // use GraphBuilder::deduplicate (or --simplify in bin/evaluate).
     vector<pair<int, int>> edges;
     edges.emplace_back(0, 1);
     edges.emplace_back(1, 2);
@@ -59,6 +105,14 @@ int main() {
     cout << "========= TREE ========" << endl;
     g = random_tree(100, 10);
     print_features(g);
+    // Quartiles are exact order statistics, also over many tied values: the
+    // leaves of a star (degree 1) fill all three.
+    auto star = UndirectedGraph(100);
+    vector<pair<int, int>> spokes;
+    for (int leaf = 1; leaf < 100; leaf++) { spokes.emplace_back(0, leaf); }
+    star.add_edges(spokes);
+    const Moments star_degree = moment_statistics(degree(star));
+    Ensures(star_degree.lower_quartile == 1 && star_degree.median == 1 && star_degree.upper_quartile == 1);
     cout << "====== BIPARTITE ======" << endl;
     g = random_bipartite(20, 30, 0.3);
     print_features(g);
@@ -66,6 +120,107 @@ int main() {
     g = erdos_renyi_gnp(10, 0.9);
     print_features(g);
 
+    // Only the selected features, and the shared work they need.
+    cout << "===== FEATURE SET =====" << endl;
+    const auto f = FeatureSet<Density, DegreeStats, Szeged>::compute(g);
+    cout << " 3. Density:               " << f.density << endl;
+    cout << " 4. Degree Mean:           " << f.degree.mean << endl;
+    cout << " 5. Degree StDev:          " << f.degree.stdev << endl;
+    cout << "12. Szeged Index:          " << f.szeged_index << endl;
+    cout << "    Revised Szeged Index:  " << f.revised_szeged_index << endl;
+
+    // With no time for exact work, path length falls back to sampling and
+    // Szeged (without an approximate mode) is missing.
+    FeatureOptions limited;
+    limited.time_limit = 0.0;
+    const auto l = FeatureSet<PathLength, Szeged>::compute(g, limited);
+    cout << " 6. Average Path Length:   " << l.average_path_length << endl;
+    cout << "    APL Approximate:       " << l.average_path_length_sampled << endl;
+    cout << "    Szeged Missing:        " << l.is_missing<Szeged>() << endl;
+
+    // Compressed adjacency (read without holding the edge list) for graphs
+    // too large for Adjacency: the native kernels must agree on both.
+    cout << "===== COMPRESSED ======" << endl;
+    g = read_dimacs("test.col");
+    const Adjacency& adj = g.adjacency();
+    const CompressedAdjacency compressed = read_dimacs_compressed("test.col");
+    cout << "    Adjacency Bytes:       " << (adj.vertices() + 1) * sizeof(std::size_t) + adj.entries() * sizeof(uint32_t)
+         << endl;
+    cout << "    Compressed Bytes:      " << compressed.memory_bytes() << endl;
+    bool neighbours_match = compressed.vertices() == adj.vertices() && compressed.entries() == adj.entries();
+    for (int v = 0; neighbours_match && v < adj.vertices(); v++) {
+        const auto list = compressed.neighbours(v);
+        const auto expected = adj.neighbours(v);
+        neighbours_match = equal(list.begin(), list.end(), expected.begin(), expected.end());
+    }
+    cout << "    Neighbours Match:      " << neighbours_match << endl;
+    const auto triangles = count_triangles(adj), compressed_triangles = count_triangles(compressed);
+    cout << "    Triangles:             " << triangles << " " << compressed_triangles << endl;
+    BreadthFirstSearch bfs(adj);
+    BasicBreadthFirstSearch<CompressedAdjacency> compressed_bfs(compressed);
+    bool eccentricities_match = true;
+    for (int v = 0; v < adj.vertices(); v++) {
+        eccentricities_match = eccentricities_match && bfs.run(v) == compressed_bfs.run(v);
+    }
+    cout << "    Eccentricities Match:  " << eccentricities_match << endl;
+    const double top = lanczos_adjacency(adj, 1, SpectrumEnd::largest).values[0];
+    const double compressed_top = lanczos_adjacency(compressed, 1, SpectrumEnd::largest).values[0];
+    cout << "    Top Eigenvalue:        " << top << " " << compressed_top << endl;
+    Ensures(neighbours_match && eccentricities_match && triangles == compressed_triangles);
+    Ensures(fabs(top - compressed_top) <= 1e-8 * fabs(top));
+
+    // Edge lists with repeats in either order and self loops: simplifying
+    // keeps one of each edge and reports what it removed.
+    cout << "====== SIMPLIFY =======" << endl;
+    const auto col_file = filesystem::temp_directory_path() / "simplify.col";
+    {
+        ofstream out(col_file);
+        out << "c (1, 2) three times, (3, 3) a self loop\n"
+            << "p edge 4 6\n"
+            << "e 1 2\ne 2 1\ne 2 3\ne 3 3\ne 3 4\ne 1 2\n";
+    }
+    DimacsOptions simplify;
+    simplify.simplify = true;
+    DimacsReport report;
+    g = read_dimacs(col_file.string(), simplify, &report);
+    filesystem::remove(col_file);
+    cout << "    Declared Edges:        " << report.declared_edges << endl;
+    cout << "    Edge Lines:            " << report.edge_lines << endl;
+    cout << "    Duplicate Edges:       " << report.duplicate_edges << endl;
+    cout << "    Self Loops:            " << report.self_loops << endl;
+    cout << " 2. Edges:                 " << g.edges() << endl;
+
+    // Large enough (over 2 x 65536 edges) for the radix sort to split over
+    // two threads; the result must match a single threaded build.
+    const int n = 1000;
+    mt19937 random(1);
+    vector<pair<int, int>> repeated;
+    for (int i = 0; i < 70000; i++) {
+        const int a = random() % n, b = random() % n;
+        repeated.emplace_back(a, b);
+        repeated.emplace_back(b, a);
+    }
+    for (int v = 0; v < n; v += 10) { repeated.emplace_back(v, v); }
+    GraphBuilder single(n, 1), threaded(n, 2);
+    single.add_edges(repeated);
+    threaded.add_edges(move(repeated));
+    cout << "    Edges Added:           " << threaded.size() << endl;
+    const std::size_t duplicates = threaded.deduplicate(), self_loops = threaded.drop_self_loops();
+    single.deduplicate();
+    single.drop_self_loops();
+    cout << "    Duplicate Edges:       " << duplicates << endl;
+    cout << "    Self Loops:            " << self_loops << endl;
+    const UndirectedGraph built = threaded.build(), expected = single.build();
+    cout << " 2. Edges:                 " << built.edges() << endl;
+    bool builds_match = built.edges() == expected.edges() && built.self_loops().empty();
+    for (int v = 0; builds_match && v < n; v++) {
+        const auto list = built.adjacency().neighbours(v);
+        const auto reference = expected.adjacency().neighbours(v);
+        builds_match = equal(list.begin(), list.end(), reference.begin(), reference.end());
+    }
+    cout << "    Threaded Build Match:  " << builds_match << endl;
+    Ensures(report.duplicate_edges == 2 && report.self_loops == 1 && builds_match);
+
     return 0;
 
 }
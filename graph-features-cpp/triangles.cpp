@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "gsl/gsl_assert"
+#include "hash.hpp"
+#include "triangles.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    // Calls visit(u, v, w) once per triangle.
+    template<class Graph, class Visit>
+    void for_each_triangle(const Graph& adj, Visit visit) {
+
+        const int n = adj.vertices();
+        auto before = [&](int a, int b) {
+            return (adj.degree(a) < adj.degree(b)) || ((adj.degree(a) == adj.degree(b)) && (a < b));
+        };
+
+        // Each triangle is found once from its lowest ranked vertex u, via its
+        // middle ranked vertex v, closing on a marked forward neighbour of u.
+        vector<char> marked(n, false);
+        for (int u = 0; u < n; u++) {
+            for (const auto v : adj.neighbours(u)) {
+                if (before(u, v)) { marked[v] = true; }
+            }
+            for (const auto v : adj.neighbours(u)) {
+                if (!before(u, v)) { continue; }
+                for (const auto w : adj.neighbours(v)) {
+                    if (before(v, w) && marked[w]) { visit(u, v, w); }
+                }
+            }
+            for (const auto v : adj.neighbours(u)) { marked[v] = false; }
+        }
+    }
+
+}
+
+
+uint64_t count_triangles(const Adjacency& adj) {
+    uint64_t triangles = 0;
+    for_each_triangle(adj, [&](int, int, int) { triangles++; });
+    return triangles;
+}
+
+
+uint64_t count_triangles(const CompressedAdjacency& adj) {
+    uint64_t triangles = 0;
+    for_each_triangle(adj, [&](int, int, int) { triangles++; });
+    return triangles;
+}
+
+
+vector<uint64_t> vertex_triangles(const Adjacency& adj) {
+    vector<uint64_t> triangles(adj.vertices(), 0);
+    for_each_triangle(adj, [&](int u, int v, int w) {
+        triangles[u]++;
+        triangles[v]++;
+        triangles[w]++;
+    });
+    return triangles;
+}
+
+
+TransitivityEstimate sample_transitivity(const Adjacency& adj, int samples, unsigned seed) {
+
+    Expects(samples > 0);
+    const int n = adj.vertices();
+
+    // Cumulative wedge counts for proportional centre selection.
+    vector<double> cumulative(n);
+    double wedges = 0.0;
+    for (int v = 0; v < n; v++) {
+        double d = adj.degree(v);
+        wedges += d * (d - 1) / 2;
+        cumulative[v] = wedges;
+    }
+
+    TransitivityEstimate res;
+    if (wedges == 0) { return res; }
+
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> centre_draw(0.0, wedges);
+    int closed = 0;
+    for (int s = 0; s < samples; s++) {
+        int v = min<int>(upper_bound(cumulative.begin(), cumulative.end(), centre_draw(rng)) - cumulative.begin(), n - 1);
+        // A draw rounding onto the total lands past the last centre.
+        while (adj.degree(v) < 2) { v--; }
+        auto nbrs = adj.neighbours(v);
+        uniform_int_distribution<int> first_draw(0, nbrs.size() - 1), second_draw(0, nbrs.size() - 2);
+        int i = first_draw(rng);
+        int j = second_draw(rng);
+        if (j >= i) { j++; }
+        closed += adj.adjacent(nbrs[i], nbrs[j]);
+    }
+
+    res.value = double(closed) / samples;
+    res.variance = res.value * (1 - res.value) / samples;
+    return res;
+}
+
+
+TransitivityStream::TransitivityStream(int vertices, uint64_t colours, unsigned seed)
+    : colours(max<uint64_t>(1, colours)), degrees(vertices, 0) {
+    // A single class keeps every edge: one exact repetition is enough.
+    int reps = (this->colours == 1) ? 1 : repetitions;
+    for (int r = 0; r < reps; r++) {
+        seeds.push_back(splitmix64(uint64_t(seed) * repetitions + r));
+    }
+    kept.resize(reps);
+}
+
+
+uint64_t TransitivityStream::colours_for_budget(uint64_t edges, uint64_t budget) {
+    return max<uint64_t>(1, (edges * repetitions) / max<uint64_t>(1, budget));
+}
+
+
+void TransitivityStream::add_edge(int a, int b) {
+    if (a < 0 || b < 0 || a >= (int) degrees.size() || b >= (int) degrees.size()) {
+        throw "Vertex out of range.";
+    }
+    if (a == b) { return; }
+    degrees[a]++;
+    degrees[b]++;
+    for (std::size_t r = 0; r < seeds.size(); r++) {
+        if (splitmix64(a ^ seeds[r]) % colours == splitmix64(b ^ seeds[r]) % colours) {
+            kept[r].emplace_back(a, b);
+        }
+    }
+}
+
+
+TransitivityEstimate TransitivityStream::estimate() const {
+
+    double wedges = 0.0;
+    for (const int d : degrees) { wedges += double(d) * (d - 1) / 2; }
+
+    TransitivityEstimate res;
+    if (wedges == 0) { return res; }
+
+    // Every triangle survives a repetition with probability 1 / colours^2.
+    vector<double> values;
+    for (const auto& edges : kept) {
+        double triangles = count_triangles(Adjacency(degrees.size(), edges));
+        values.push_back(3 * triangles * colours * colours / wedges);
+    }
+
+    double k = values.size();
+    for (const double v : values) { res.value += v / k; }
+    if (k > 1) {
+        for (const double v : values) { res.variance += (v - res.value) * (v - res.value); }
+        res.variance /= (k - 1) * k;
+    }
+    return res;
+}
+
+
+}
@@ -0,0 +1,69 @@
+
+#ifndef TRIANGLES_HPP
+#define TRIANGLES_HPP
+
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "adjacency.hpp"
+#include "compressed.hpp"
+
+
+namespace graph {
+
+
+    // Exact triangle count (each triangle once), by orienting edges from
+    // lower to higher (degree, id) rank and intersecting forward neighbourhoods.
+    uint64_t count_triangles(const Adjacency&);
+    uint64_t count_triangles(const CompressedAdjacency&);
+
+    // Triangles through each vertex, by the same enumeration.
+    std::vector<uint64_t> vertex_triangles(const Adjacency&);
+
+    // Transitivity estimate with the variance of the estimator.
+    struct TransitivityEstimate {
+        double value = 0.0;
+        double variance = 0.0;
+    };
+
+    // Wedge sampling (Seshadhri, Pinar & Kolda): centres are drawn with
+    // probability proportional to their wedge count, then a uniform pair of
+    // neighbours; the closed fraction of samples estimates transitivity with
+    // binomial variance p(1 - p) / samples.
+    TransitivityEstimate sample_transitivity(const Adjacency&, int samples, unsigned seed);
+
+    // Single pass transitivity estimate over an edge stream, with colour coding
+    // (Pagh & Tsourakakis). Each of several independent repetitions colours
+    // the vertices with a hash into `colours` classes and keeps only
+    // monochromatic edges, so about repetitions * m / colours edges are held.
+    // Triangles among kept edges are scaled by colours^2; wedges are exact from
+    // the streamed degrees. The variance is that of the mean over repetitions.
+
+    class TransitivityStream {
+
+        static constexpr int repetitions = 8;
+
+        uint64_t colours;
+        std::vector<uint64_t> seeds;
+        std::vector<int> degrees;
+        std::vector<std::vector<std::pair<int, int>>> kept;
+
+     public:
+
+        TransitivityStream(int vertices, uint64_t colours, unsigned seed);
+
+        // Colour count keeping roughly `budget` edges in total out of `edges`.
+        static uint64_t colours_for_budget(uint64_t edges, uint64_t budget);
+
+        void add_edge(int a, int b);
+        TransitivityEstimate estimate() const;
+
+    };
+
+
+}
+
+
+#endif
@@ -4,6 +4,12 @@
 
 #include "math.h"
 
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <utility>
+
 #include "gsl/span"
 #include "igraph/igraph.h"
 
@@ -79,24 +85,197 @@ namespace graph {
 
     };
 
-    template<class T>
-    std::pair<double, double> simple_statistics(T d) {
+    // Distribution summary of a vector feature. Standard deviation is the
+    // sample (n - 1) estimate; skewness and excess kurtosis are the population
+    // moment ratios m3 / m2^1.5 and m4 / m2^2 - 3 (zero for constant data).
+    // Quartiles and median are exact, interpolating linearly between order
+    // statistics.
+    struct Moments {
+        double count = 0.0;
+        double mean = 0.0;
+        double stdev = 0.0;
+        double skewness = 0.0;
+        double kurtosis = 0.0;
+        double min = 0.0;
+        double max = 0.0;
+        double lower_quartile = 0.0;
+        double median = 0.0;
+        double upper_quartile = 0.0;
+    };
 
-        double n = d.size();
+    namespace impl {
+
+        // P-square estimator (Jain & Chlamtac 1985) of the median in O(1)
+        // memory, for values streamed without being held. Its five markers
+        // track the minimum, lower quartile, median, upper quartile and
+        // maximum, adjusted by piecewise parabolic steps as values arrive. The
+        // first five values are kept exactly; beyond those the estimate can
+        // be far off on tied or ordered data, so held vectors use quantile.
+        class PSquare {
+
+            double height[5];
+            double position[5] = {0, 1, 2, 3, 4};
+            double desired[5] = {0, 1, 2, 3, 4};
+            int count = 0;
+
+            double parabolic(int i, double s) const {
+                return height[i] + s / (position[i + 1] - position[i - 1]) * (
+                    (position[i] - position[i - 1] + s) * (height[i + 1] - height[i]) / (position[i + 1] - position[i]) +
+                    (position[i + 1] - position[i] - s) * (height[i] - height[i - 1]) / (position[i] - position[i - 1]));
+            }
+
+         public:
+
+            void add(double x) {
+                if (count < 5) {
+                    height[count++] = x;
+                    std::sort(height, height + count);
+                    return;
+                }
+                count++;
+                int k;
+                if (x < height[0]) {
+                    height[0] = x;
+                    k = 0;
+                } else if (x >= height[4]) {
+                    height[4] = x;
+                    k = 3;
+                } else {
+                    k = 0;
+                    while (x >= height[k + 1]) { k++; }
+                }
+                for (int i = k + 1; i < 5; i++) { position[i] += 1; }
+                for (int i = 1; i < 5; i++) { desired[i] += 0.25 * i; }
+                for (int i = 1; i < 4; i++) {
+                    double d = desired[i] - position[i];
+                    if ((d >= 1 && position[i + 1] - position[i] > 1) || (d <= -1 && position[i - 1] - position[i] < -1)) {
+                        double s = (d > 0) ? 1.0 : -1.0;
+                        double candidate = parabolic(i, s);
+                        if (height[i - 1] < candidate && candidate < height[i + 1]) {
+                            height[i] = candidate;
+                        } else {
+                            int j = i + int(s);
+                            height[i] += s * (height[j] - height[i]) / (position[j] - position[i]);
+                        }
+                        position[i] += s;
+                    }
+                }
+            }
+
+            // Linear interpolation between order statistics while exact.
+            double quantile(double p) const {
+                if (count >= 5) { return height[int(p * 4)]; }
+                double r = p * (count - 1);
+                int i = int(r);
+                return (i + 1 < count) ? height[i] + (r - i) * (height[i + 1] - height[i]) : height[i];
+            }
+
+        };
+
+        struct Identity {
+            double operator()(double x) const { return x; }
+        };
+
+        // Quantile p of values (left reordered) in O(n) by selection,
+        // interpolating linearly between order statistics.
+        inline double quantile(std::vector<double>& values, double p) {
+            const double r = p * (values.size() - 1);
+            const std::size_t i = r;
+            std::nth_element(values.begin(), values.begin() + i, values.end());
+            if (i + 1 >= values.size()) { return values[i]; }
+            const double next = *std::min_element(values.begin() + i + 1, values.end());
+            return values[i] + (r - i) * (next - values[i]);
+        }
 
-        double mean = 0.0;
-        for (const auto & vd : d) {
-            mean += vd;
+    }
+
+    // Single pass over d, applying transform (e.g. fabs) to each value on
+    // the fly. Power sums are taken about the first value (for stability) in
+    // four independent lanes, so blocks of four vectorise. Quantiles select
+    // from a copy of the transformed values.
+    template<class T, class Transform = impl::Identity>
+    Moments moment_statistics(const T& d, Transform transform = Transform()) {
+
+        Moments res;
+        const std::ptrdiff_t n = d.size();
+        res.count = n;
+        if (n == 0) {
+            res.mean = res.stdev = NAN;
+            return res;
         }
-        mean /= n;
 
-        double stdev = 0.0;
-        for (const auto & vd : d) {
-            stdev += (vd - mean) * (vd - mean);
+        auto it = d.begin();
+        const double shift = transform(it[0]);
+        double s1[4] = {0, 0, 0, 0}, s2[4] = {0, 0, 0, 0}, s3[4] = {0, 0, 0, 0}, s4[4] = {0, 0, 0, 0};
+        double low[4] = {shift, shift, shift, shift}, high[4] = {shift, shift, shift, shift};
+        std::vector<double> values(n);
+
+        auto accumulate = [&](int lane, double x) {
+            double y = x - shift, y2 = y * y;
+            s1[lane] += y;
+            s2[lane] += y2;
+            s3[lane] += y2 * y;
+            s4[lane] += y2 * y2;
+            low[lane] = (x < low[lane]) ? x : low[lane];
+            high[lane] = (x > high[lane]) ? x : high[lane];
+        };
+
+        std::ptrdiff_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            double x[4];
+            for (int lane = 0; lane < 4; lane++) { x[lane] = transform(it[i + lane]); }
+            for (int lane = 0; lane < 4; lane++) { accumulate(lane, x[lane]); }
+            for (int lane = 0; lane < 4; lane++) { values[i + lane] = x[lane]; }
+        }
+        for (; i < n; i++) {
+            double x = transform(it[i]);
+            accumulate(0, x);
+            values[i] = x;
+        }
+
+        // Central moments from the shifted power sums.
+        const double a = (s1[0] + s1[1] + s1[2] + s1[3]) / n;
+        const double b = (s2[0] + s2[1] + s2[2] + s2[3]) / n;
+        const double c = (s3[0] + s3[1] + s3[2] + s3[3]) / n;
+        const double e = (s4[0] + s4[1] + s4[2] + s4[3]) / n;
+        const double m2 = std::max(0.0, b - a * a);
+        const double m3 = c - 3 * a * b + 2 * a * a * a;
+        const double m4 = e - 4 * a * c + 6 * a * a * b - 3 * a * a * a * a;
+
+        res.mean = shift + a;
+        res.stdev = sqrt(m2 * n / (n - 1.0));
+        if (m2 > 0) {
+            res.skewness = m3 / (m2 * sqrt(m2));
+            res.kurtosis = m4 / (m2 * m2) - 3;
         }
-        stdev = sqrt(stdev / (n - 1.0));
+        res.min = *std::min_element(low, low + 4);
+        res.max = *std::max_element(high, high + 4);
+        res.lower_quartile = impl::quantile(values, 0.25);
+        res.median = impl::quantile(values, 0.5);
+        res.upper_quartile = impl::quantile(values, 0.75);
+        return res;
+    }
+
+    // Mean and (sample) standard deviation.
+    template<class T>
+    std::pair<double, double> simple_statistics(const T& d) {
+        const Moments res = moment_statistics(d);
+        return std::make_pair(res.mean, res.stdev);
+    }
 
-        return std::make_pair(mean, stdev);
+    // Distribution shape lines for a vector feature, after its mean and stdev.
+    inline void print_distribution(std::ostream& out, const std::string& name, const Moments& m) {
+        auto line = [&](const std::string& statistic, double value) {
+            out << std::left << std::setw(27) << ("    " + name + " " + statistic + ":") << std::right << value
+                << std::endl;
+        };
+        line("Skewness", m.skewness);
+        line("Kurtosis", m.kurtosis);
+        line("Min", m.min);
+        line("Q1", m.lower_quartile);
+        line("Median", m.median);
+        line("Q3", m.upper_quartile);
+        line("Max", m.max);
     }
 
 }
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+#include "hash.hpp"
+#include "parallel.hpp"
+#include "wl.hpp"
+
+
+using namespace std;
+
+
+namespace graph {
+
+
+namespace {
+
+    // Distinct salts per lane and per use keep the lanes independent.
+    constexpr uint64_t own_salt[2] = {0x8a5cd789635d2dffULL, 0x121fd2155c472f96ULL};
+    constexpr uint64_t neighbour_salt[2] = {0xde84f3ab6e9a1c4dULL, 0x2f1b5c3a7e6d4b09ULL};
+    constexpr uint64_t multiset_salt[2] = {0x5851f42d4c957f2dULL, 0x14057b7ef767814fULL};
+
+    uint64_t combine(uint64_t seed, uint64_t value) {
+        return splitmix64(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+    }
+
+}
+
+
+string Hash128::hex() const {
+    char buffer[33];
+    snprintf(buffer, sizeof(buffer), "%016llx%016llx", (unsigned long long) high, (unsigned long long) low);
+    return buffer;
+}
+
+
+WeisfeilerLehman::WeisfeilerLehman(const Adjacency& adj, int threads)
+    : adj(adj), threads(threads), current(adj.vertices()), next(adj.vertices()) {
+    for (int v = 0; v < adj.vertices(); v++) {
+        current[v].high = splitmix64(adj.degree(v) ^ own_salt[0]);
+        current[v].low = splitmix64(adj.degree(v) ^ own_salt[1]);
+    }
+}
+
+
+void WeisfeilerLehman::refine() {
+    parallel_ranges(adj.vertices(), threads, [&](int, int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            uint64_t high = 0, low = 0;
+            for (const auto u : adj.neighbours(v)) {
+                high += splitmix64(current[u].high ^ neighbour_salt[0]);
+                low += splitmix64(current[u].low ^ neighbour_salt[1]);
+            }
+            next[v].high = combine(current[v].high ^ own_salt[0], high);
+            next[v].low = combine(current[v].low ^ own_salt[1], low);
+        }
+    });
+    swap(current, next);
+    iterations++;
+}
+
+
+Hash128 WeisfeilerLehman::label_multiset() const {
+    Hash128 res;
+    for (const auto& label : current) {
+        res.high += splitmix64(label.high ^ multiset_salt[0]);
+        res.low += splitmix64(label.low ^ multiset_salt[1]);
+    }
+    return res;
+}
+
+
+vector<uint32_t> WeisfeilerLehman::label_histogram(int width) const {
+    const int workers = (threads > 0) ? threads : max(1u, thread::hardware_concurrency());
+    vector<vector<uint32_t>> partial(workers);
+    parallel_ranges(current.size(), workers, [&](int t, int begin, int end) {
+        auto& counts = partial[t];
+        counts.assign(width, 0);
+        for (int v = begin; v < end; v++) { counts[current[v].low % width]++; }
+    });
+    vector<uint32_t> res(width, 0);
+    for (const auto& counts : partial) {
+        for (std::size_t bin = 0; bin < counts.size(); bin++) { res[bin] += counts[bin]; }
+    }
+    return res;
+}
+
+
+WLSketch wl_sketch(const Adjacency& adj, int iterations, int width, int threads) {
+    WLSketch res;
+    res.fingerprint.high = combine(adj.vertices(), adj.entries());
+    res.fingerprint.low = combine(adj.entries(), adj.vertices());
+    WeisfeilerLehman wl(adj, threads);
+    for (;;) {
+        const Hash128 multiset = wl.label_multiset();
+        res.fingerprint.high = combine(res.fingerprint.high, multiset.high);
+        res.fingerprint.low = combine(res.fingerprint.low, multiset.low);
+        if (wl.iteration() > 0 && width > 0) { res.histograms.push_back(wl.label_histogram(width)); }
+        if (wl.iteration() >= iterations) { break; }
+        wl.refine();
+    }
+    return res;
+}
+
+
+Hash128 wl_fingerprint(const Adjacency& adj, int iterations, int threads) {
+    return wl_sketch(adj, iterations, 0, threads).fingerprint;
+}
+
+
+}
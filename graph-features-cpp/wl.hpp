@@ -0,0 +1,87 @@
+
+#ifndef WL_HPP
+#define WL_HPP
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "adjacency.hpp"
+
+
+namespace graph {
+
+
+    // 128 bit hash, as two independent 64 bit lanes.
+    struct Hash128 {
+        uint64_t high = 0;
+        uint64_t low = 0;
+
+        bool operator==(const Hash128& other) const { return high == other.high && low == other.low; }
+        bool operator!=(const Hash128& other) const { return !(*this == other); }
+        bool operator<(const Hash128& other) const {
+            return high < other.high || (high == other.high && low < other.low);
+        }
+
+        // 32 hex digits.
+        std::string hex() const;
+    };
+
+    // Weisfeiler-Lehman colour refinement with hashed labels. Vertices start
+    // labelled by degree; each iteration relabels every vertex with a hash of
+    // its own label and the multiset of its neighbours' labels (a sum of mixed
+    // neighbour labels, so no sorting is needed and an iteration is O(n + m),
+    // split over threads with 0 = hardware concurrency).
+    //
+    // Isomorphic graphs always produce the same labels as multisets, so equal
+    // graph hashes are necessary for isomorphism. The converse holds unless WL
+    // cannot distinguish the graphs (e.g. regular graphs of equal size and
+    // degree) or hashes collide.
+
+    class WeisfeilerLehman {
+
+        const Adjacency& adj;
+        int threads;
+        int iterations = 0;
+        std::vector<Hash128> current;
+        std::vector<Hash128> next;
+
+     public:
+
+        explicit WeisfeilerLehman(const Adjacency&, int threads = 0);
+
+        void refine();
+
+        int iteration() const { return iterations; }
+        const std::vector<Hash128>& labels() const { return current; }
+
+        // Hash of the multiset of current labels.
+        Hash128 label_multiset() const;
+
+        // Counts of current labels folded into `width` bins by label hash.
+        std::vector<uint32_t> label_histogram(int width) const;
+
+    };
+
+    // Fingerprint of a graph: its size and the label multiset hashes after
+    // 0 .. iterations refinements, chained together.
+    Hash128 wl_fingerprint(const Adjacency&, int iterations, int threads = 0);
+
+    // Fingerprint and WL subtree label histograms from one refinement pass:
+    // histograms[i - 1] holds the labels after i = 1 .. iterations
+    // refinements, counted into `width` hashed bins (no histograms if width
+    // is 0). Each bin sums the counts of every label hashed to it, so equal
+    // graphs give equal histograms and similar ones similar histograms.
+    struct WLSketch {
+        Hash128 fingerprint;
+        std::vector<std::vector<uint32_t>> histograms;
+    };
+
+    WLSketch wl_sketch(const Adjacency&, int iterations, int width, int threads = 0);
+
+
+}
+
+
+#endif